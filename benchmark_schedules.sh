@@ -0,0 +1,114 @@
+#!/bin/sh
+# Barrido de políticas de scheduling de OpenMP sobre los benchmarks headless.
+#
+# Para cada cantidad de estrellas corre screensaver_secuencial como línea
+# base y luego cada kernel paralelo con cada combinación de threads,
+# schedule y chunk:
+#   paralelo1 fisica         (--sched-physics)
+#   paralelo2 fisica         (--sched-physics, interacciones con su valor por defecto)
+#   paralelo2 interacciones  (--sched-interactions, física con su valor por defecto)
+#
+# Speedup = pasos/seg del build / pasos/seg del secuencial; eficiencia =
+# speedup / threads. speedup_kernel compara solo la fase de física (el
+# secuencial no tiene interacciones). Ojo: paralelo2 hace además grid e
+# interacciones, así que su speedup total mide más trabajo que la base.
+#
+# Todo se configura por variables de entorno, por ejemplo:
+#   STARS="1000 10000" THREADS="1 2 4" SCHEDULES="static dynamic" ./benchmark_schedules.sh
+#
+# Con muchas estrellas las interacciones de paralelo2 crecen con la densidad;
+# P2_MAX_STARS limita hasta dónde se corre ese build.
+
+set -e
+
+BIN_DIR=${BIN_DIR:-.}
+STARS=${STARS:-"1000 10000 100000 1000000"}
+NPROC=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+if [ -z "$THREADS" ]; then
+    THREADS=1
+    t=2
+    while [ "$t" -le "$NPROC" ]; do
+        THREADS="$THREADS $t"
+        t=$((t * 2))
+    done
+fi
+SCHEDULES=${SCHEDULES:-"static dynamic guided"}
+CHUNKS=${CHUNKS:-"0 16 256"}        # 0 = chunk por defecto de la política
+FRAMES=${FRAMES:-50}
+SEED=${SEED:-12345}
+P2_MAX_STARS=${P2_MAX_STARS:-100000}
+P2_FLAGS=${P2_FLAGS:-"--no-pipeline"}
+RESULTS=${RESULTS:-resultados_schedules.csv}
+
+SECUENCIAL="$BIN_DIR/screensaver_secuencial"
+PARALELO1="$BIN_DIR/screensaver_paralelo1"
+PARALELO2="$BIN_DIR/screensaver_paralelo2"
+
+for bin in "$SECUENCIAL" "$PARALELO1" "$PARALELO2"; do
+    if [ ! -x "$bin" ]; then
+        echo "Error: no se encontró $bin (compilar con make)" >&2
+        exit 1
+    fi
+done
+
+# Valor anterior a "pasos/seg" en la línea "Pasos:" del reporte headless
+steps_per_second() {
+    awk '$1 == "Pasos:" { for (i = 2; i <= NF; i++) if ($i == "pasos/seg") print $(i - 1) }'
+}
+
+# ms/frame de una fase ("Física:", "Interacciones:") del reporte headless
+phase_ms() {
+    awk -v phase="$1" '$1 == phase { for (i = 2; i <= NF; i++) if ($i == "ms/frame") print $(i - 1) }'
+}
+
+echo "build,kernel,estrellas,threads,schedule,pasos_seg,kernel_ms,speedup,eficiencia,speedup_kernel" > "$RESULTS"
+printf "%-10s %-14s %9s %7s %-13s %11s %10s %8s %10s %9s\n" \
+    "Build" "Kernel" "Estrellas" "Threads" "Schedule" "Pasos/seg" "Kernel ms" "Speedup" "Eficiencia" "Sp.kernel"
+
+report() {
+    # build kernel estrellas threads schedule pasos_seg kernel_ms base_pasos base_ms
+    awk -v build="$1" -v kernel="$2" -v stars="$3" -v threads="$4" -v sched="$5" \
+        -v sps="$6" -v kms="$7" -v base_sps="$8" -v base_ms="$9" -v csv="$RESULTS" 'BEGIN {
+        speedup = (base_sps > 0) ? sps / base_sps : 0
+        eff = speedup / threads
+        ks = (base_ms != "" && kms > 0) ? sprintf("%.2f", base_ms / kms) : "-"
+        printf "%-10s %-14s %9d %7d %-13s %11.1f %10.4f %8.2f %9.1f%% %9s\n",
+               build, kernel, stars, threads, sched, sps, kms, speedup, eff * 100, ks
+        printf "%s,%s,%d,%d,%s,%.1f,%.4f,%.3f,%.3f,%s\n",
+               build, kernel, stars, threads, sched, sps, kms, speedup, eff, ks >> csv
+    }'
+}
+
+for n in $STARS; do
+    out=$("$SECUENCIAL" "$n" --headless --frames "$FRAMES" --seed "$SEED")
+    base_sps=$(echo "$out" | steps_per_second)
+    base_ms=$(echo "$out" | phase_ms "Física:")
+    report secuencial fisica "$n" 1 "-" "$base_sps" "$base_ms" "$base_sps" "$base_ms"
+
+    for t in $THREADS; do
+        for s in $SCHEDULES; do
+            for c in $CHUNKS; do
+                if [ "$c" = "0" ]; then sched="$s"; else sched="$s,$c"; fi
+
+                out=$(OMP_NUM_THREADS=$t "$PARALELO1" "$n" --headless --frames "$FRAMES" --seed "$SEED" \
+                      --sched-physics "$sched")
+                report paralelo1 fisica "$n" "$t" "$sched" \
+                    "$(echo "$out" | steps_per_second)" "$(echo "$out" | phase_ms "Física:")" "$base_sps" "$base_ms"
+
+                if [ "$n" -le "$P2_MAX_STARS" ]; then
+                    out=$(OMP_NUM_THREADS=$t "$PARALELO2" "$n" --headless --frames "$FRAMES" --seed "$SEED" \
+                          $P2_FLAGS --sched-physics "$sched")
+                    report paralelo2 fisica "$n" "$t" "$sched" \
+                        "$(echo "$out" | steps_per_second)" "$(echo "$out" | phase_ms "Física:")" "$base_sps" "$base_ms"
+
+                    out=$(OMP_NUM_THREADS=$t "$PARALELO2" "$n" --headless --frames "$FRAMES" --seed "$SEED" \
+                          $P2_FLAGS --sched-interactions "$sched")
+                    report paralelo2 interacciones "$n" "$t" "$sched" \
+                        "$(echo "$out" | steps_per_second)" "$(echo "$out" | phase_ms "Interacciones:")" "$base_sps" ""
+                fi
+            done
+        done
+    done
+done
+
+echo "Resultados guardados en $RESULTS"
@@ -0,0 +1,130 @@
+#!/bin/sh
+# Regresión de la física contra snapshots golden (directorio golden/).
+#
+# Todos los motores arrancan del mismo estado (golden/init.stars), corren
+# STEPS pasos headless y comparan x, y, vx, vy con --compare:
+#   secuencial                   apply_physics              -> golden/fisica.stars
+#   paralelo1                    su copia OpenMP            -> golden/fisica.stars
+#   paralelo2 --no-interactions  apply_physics_optimized    -> golden/fisica.stars
+#   paralelo2 (con/sin pipeline) física + interacciones     -> golden/paralelo2.stars
+#
+# Además cada build debe rechazar snapshots malformados (truncado, o con un
+# column_stride que desborda el chequeo de tamaño) con un error limpio y no
+# con una señal.
+#
+# Sale con código 1 si algún motor supera la tolerancia o algún rechazo
+# falla. Para regenerar los
+# golden después de un cambio intencional de la física:
+#   UPDATE=1 ./regression.sh
+# (fisica.stars sale de secuencial, la referencia; paralelo2.stars de
+# paralelo2 sin pipeline).
+
+set -e
+
+BIN_DIR=${BIN_DIR:-.}
+GOLDEN_DIR=${GOLDEN_DIR:-golden}
+STARS=${STARS:-1000}          # Solo al regenerar (UPDATE=1)
+SEED=${SEED:-12345}           # Solo al regenerar (UPDATE=1)
+STEPS=${STEPS:-600}
+TOLERANCE=${TOLERANCE:-1e-3}  # Píxeles / píxeles por paso
+UPDATE=${UPDATE:-0}
+
+SECUENCIAL="$BIN_DIR/screensaver_secuencial"
+PARALELO1="$BIN_DIR/screensaver_paralelo1"
+PARALELO2="$BIN_DIR/screensaver_paralelo2"
+
+for bin in "$SECUENCIAL" "$PARALELO1" "$PARALELO2"; do
+    if [ ! -x "$bin" ]; then
+        echo "Error: no se encontró $bin (compilar con make)" >&2
+        exit 1
+    fi
+done
+
+if [ "$UPDATE" = "1" ]; then
+    mkdir -p "$GOLDEN_DIR"
+    "$SECUENCIAL" "$STARS" --headless --frames 0 --seed "$SEED" --save "$GOLDEN_DIR/init.stars" > /dev/null
+    "$SECUENCIAL" 1 --load "$GOLDEN_DIR/init.stars" --headless --frames "$STEPS" \
+        --save "$GOLDEN_DIR/fisica.stars" > /dev/null
+    "$PARALELO2" 1 --load "$GOLDEN_DIR/init.stars" --headless --frames "$STEPS" --no-pipeline \
+        --save "$GOLDEN_DIR/paralelo2.stars" > /dev/null
+    echo "Golden regenerados en $GOLDEN_DIR ($STARS estrellas, semilla $SEED, $STEPS pasos)"
+fi
+
+if [ ! -f "$GOLDEN_DIR/init.stars" ]; then
+    echo "Error: falta $GOLDEN_DIR/init.stars (generar con UPDATE=1)" >&2
+    exit 1
+fi
+
+failures=0
+printf "%-28s %-16s %11s %11s %11s %11s  %s\n" "Motor" "Golden" "x" "y" "vx" "vy" "Resultado"
+
+# motor golden binario [opciones...]
+check() {
+    name=$1
+    golden=$2
+    bin=$3
+    shift 3
+    status=0
+    out=$("$bin" 1 --load "$GOLDEN_DIR/init.stars" --headless --frames "$STEPS" "$@" \
+          --compare "$GOLDEN_DIR/$golden" --tolerance "$TOLERANCE") || status=$?
+    # Máximo de cada columna en las líneas "  x   máx ... | rms ..."
+    drift=$(echo "$out" | awk '$2 == "máx" { printf " %11s", $3 }')
+    if [ "$status" -eq 0 ]; then
+        result=OK
+    else
+        result=FALLA
+        failures=$((failures + 1))
+    fi
+    printf "%-28s %-16s%s  %s\n" "$name" "$golden" "$drift" "$result"
+    if [ "$status" -ne 0 ] && [ -z "$drift" ]; then
+        echo "$out" | grep -i "error" >&2 || true
+    fi
+}
+
+check "secuencial"                  fisica.stars    "$SECUENCIAL"
+check "paralelo1"                   fisica.stars    "$PARALELO1"
+check "paralelo2 sin interacciones" fisica.stars    "$PARALELO2" --no-interactions --no-pipeline
+check "paralelo2"                   paralelo2.stars "$PARALELO2"
+check "paralelo2 sin pipeline"      paralelo2.stars "$PARALELO2" --no-pipeline
+
+# Snapshots malformados, derivados de init.stars. stride.stars tiene
+# column_stride = 2^60 + 64 y star_count = 100000 (offsets 24 y 32 de la
+# cabecera, little-endian): stride * 16 desborda a 1024 en 64 bits.
+bad_dir=$(mktemp -d)
+trap 'rm -rf "$bad_dir"' EXIT
+head -c 100 "$GOLDEN_DIR/init.stars" > "$bad_dir/truncado.stars"
+head -c 12288 "$GOLDEN_DIR/init.stars" > "$bad_dir/stride.stars"
+printf '\100\0\0\0\0\0\0\020\240\206\001\0\0\0\0\0' |
+    dd of="$bad_dir/stride.stars" bs=1 seek=24 conv=notrunc 2> /dev/null
+
+# motor archivo binario opciones...: espera "Error" y un código de salida
+# distinto de 0 y menor que 128 (>= 128 es muerte por señal)
+reject() {
+    name=$1
+    file=$2
+    bin=$3
+    shift 3
+    status=0
+    out=$("$bin" 1 --headless --frames 5 "$@" 2>&1) || status=$?
+    if [ "$status" -ne 0 ] && [ "$status" -lt 128 ] && echo "$out" | grep -q "Error"; then
+        result=OK
+    else
+        result="FALLA (código $status)"
+        failures=$((failures + 1))
+    fi
+    printf "%-28s %-16s%48s  %s\n" "$name" "$file" "" "$result"
+}
+
+for bin in "$SECUENCIAL" "$PARALELO1" "$PARALELO2"; do
+    motor=$(basename "$bin" | sed 's/^screensaver_//; s/\.exe$//')
+    reject "$motor --load"    truncado.stars "$bin" --load "$bad_dir/truncado.stars"
+    reject "$motor --load"    stride.stars   "$bin" --load "$bad_dir/stride.stars"
+    reject "$motor --compare" stride.stars   "$bin" --load "$GOLDEN_DIR/init.stars" \
+        --compare "$bad_dir/stride.stars"
+done
+
+if [ "$failures" -gt 0 ]; then
+    echo "$failures caso(s) fallido(s) (tolerancia $TOLERANCE)"
+    exit 1
+fi
+echo "Todos los motores dentro de la tolerancia $TOLERANCE ($STEPS pasos)"
@@ -6,7 +6,16 @@
 #include <math.h>
 #include <time.h>
 #include <string.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <omp.h> // <-- OpenMP
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
@@ -14,10 +23,11 @@
 #define MIN_CANVAS_HEIGHT 480
 #define FPS_TARGET 60
 #define PI 3.14159265359
-#define MAX_STARS 2000
+#define MAX_STARS 16777216  // Límite de cordura; el arreglo crece por duplicación
 
 typedef struct {
     float x, y;
+    float prev_x, prev_y;  // Posición al inicio del último paso (para interpolar)
     float vx, vy;
     float brightness;
     float pulse_phase;
@@ -30,44 +40,1102 @@ typedef struct {
 
 Star* stars = NULL;
 int num_stars = 0;
+int stars_capacity = 0;
 int window_id;
 clock_t last_time;
 int frame_count = 0;
 float fps = 0.0f;
-clock_t fps_timer;
+double fps_timer;
 int fps_counter = 0;
 
-void generate_star_color(Star* star) {
-    int color_type = rand() % 8;
+// Modo benchmark sin ventana (--headless --frames N)
+int headless_mode = 0;
+int headless_frames = 1000;
+int headless_substeps = 1;  // Pasos de física por frame en headless (--substeps N)
+
+// Reloj de simulación de paso fijo: la física avanza SIM_DT por paso sin
+// importar el ritmo de render; render_alpha interpola entre los dos últimos
+#define SIM_DT (1.0 / FPS_TARGET)
+#define MAX_SUBSTEPS 5  // Tope de pasos por frame: más allá se descarta el atraso
+double sim_accumulator = 0.0;
+double sim_last_time = -1.0;
+long long sim_steps = 0;
+long long fps_steps = 0;
+float render_alpha = 1.0f;
+
+// Política de scheduling de un bucle, elegible en tiempo de ejecución
+// (--sched-KERNEL tipo[,chunk]); los bucles usan schedule(runtime)
+typedef struct {
+    omp_sched_t kind;
+    int chunk;  // 0 = chunk por defecto de la política
+} LoopSchedule;
+
+static const char* schedule_kind_name(omp_sched_t kind) {
+    switch (kind) {
+        case omp_sched_static: return "static";
+        case omp_sched_dynamic: return "dynamic";
+        case omp_sched_guided: return "guided";
+        default: return "auto";
+    }
+}
+
+// Acepta "static", "dynamic,64", "guided,8", "auto"
+int parse_schedule(const char* text, LoopSchedule* out) {
+    char kind[16];
+    int chunk = 0;
+    const char* comma = strchr(text, ',');
+    size_t len = comma ? (size_t)(comma - text) : strlen(text);
+    if (len == 0 || len >= sizeof(kind)) return 0;
+    memcpy(kind, text, len);
+    kind[len] = '\0';
+    if (comma) {
+        chunk = atoi(comma + 1);
+        if (chunk <= 0) return 0;
+    }
+    
+    if (strcmp(kind, "static") == 0) out->kind = omp_sched_static;
+    else if (strcmp(kind, "dynamic") == 0) out->kind = omp_sched_dynamic;
+    else if (strcmp(kind, "guided") == 0) out->kind = omp_sched_guided;
+    else if (strcmp(kind, "auto") == 0) out->kind = omp_sched_auto;
+    else return 0;
+    out->chunk = chunk;
+    return 1;
+}
+
+// Texto "tipo" o "tipo,chunk" para los reportes
+const char* schedule_label(const LoopSchedule* sched, char* buf, size_t size) {
+    if (sched->chunk > 0) snprintf(buf, size, "%s,%d", schedule_kind_name(sched->kind), sched->chunk);
+    else snprintf(buf, size, "%s", schedule_kind_name(sched->kind));
+    return buf;
+}
+
+// Fija la política que usará el próximo bucle schedule(runtime) de este thread
+static inline void use_schedule(const LoopSchedule* sched) {
+    omp_set_schedule(sched->kind, sched->chunk);
+}
+
+LoopSchedule physics_schedule = { omp_sched_dynamic, 0 };  // --sched-physics
+
+// Trazas de línea de tiempo en formato Chrome/Perfetto (--trace ARCHIVO.json).
+// Cada carril (fila de la línea de tiempo) tiene su buffer circular y lo
+// escribe un solo thread a la vez, así que registrar un evento no necesita
+// locks; al salir se vuelcan todos al JSON. Si un buffer se llena se
+// conservan los TRACE_RING_EVENTS más recientes.
+#define TRACE_RING_EVENTS 65536
+#define TRACE_TEAM_LANES 32  // Carriles por equipo de threads
+#define TRACE_MAX_LANES (TRACE_TEAM_LANES * (TRACE_TEAM_LANES + 1))
+
+typedef struct {
+    const char* name;
+    const char* category;
+    double start;
+    double end;
+} TraceEvent;
+
+typedef struct {
+    TraceEvent* events;
+    long long written;
+    int level;      // Nivel de anidamiento de OpenMP del carril
+    int outer_tid;  // Thread del equipo exterior (solo nivel 2)
+    int team_tid;   // omp_get_thread_num() dentro de su equipo
+} TraceRing;
+
+int trace_enabled = 0;
+const char* trace_path = NULL;
+double trace_origin = 0.0;
+TraceRing trace_rings[TRACE_MAX_LANES];
+
+// Carril del thread actual. Con equipos anidados omp_get_thread_num() se
+// repite entre equipos (y libgomp puede recrear esos threads), así que el
+// nivel 2 usa un bloque de carriles por cada thread del equipo exterior.
+static TraceRing* trace_ring() {
+    int level = omp_get_level();
+    int tid = omp_get_thread_num();
+    int outer = (level >= 2) ? omp_get_ancestor_thread_num(1) : -1;
+    if (tid >= TRACE_TEAM_LANES || outer >= TRACE_TEAM_LANES) return NULL;
+    
+    int lane = (level >= 2) ? (outer + 1) * TRACE_TEAM_LANES + tid : tid;
+    TraceRing* ring = &trace_rings[lane];
+    if (!ring->events) {
+        ring->events = (TraceEvent*)malloc(TRACE_RING_EVENTS * sizeof(TraceEvent));
+        ring->level = (level < 2) ? level : 2;
+        ring->outer_tid = outer;
+        ring->team_tid = tid;
+    }
+    return ring->events ? ring : NULL;
+}
+
+static inline void trace_event(const char* name, const char* category, double start, double end) {
+    if (!trace_enabled) return;
+    TraceRing* ring = trace_ring();
+    if (!ring) return;
+    TraceEvent* ev = &ring->events[ring->written % TRACE_RING_EVENTS];
+    ev->name = name;
+    ev->category = category;
+    ev->start = start;
+    ev->end = end;
+    ring->written++;
+}
+
+void trace_begin(const char* path) {
+    trace_path = path;
+    trace_origin = omp_get_wtime();
+    trace_enabled = 1;
+}
+
+// Escribe los eventos como "complete events" (ph X) con tiempos en microsegundos
+void trace_flush() {
+    if (!trace_enabled) return;
+    trace_enabled = 0;
+    
+    FILE* out = fopen(trace_path, "w");
+    if (!out) {
+        printf("Error: No se pudo escribir la traza en %s\n", trace_path);
+        return;
+    }
+    
+    int lanes = 0;
+    long long total = 0;
+    int first = 1;
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    for (int t = 0; t < TRACE_MAX_LANES; t++) {
+        TraceRing* ring = &trace_rings[t];
+        if (!ring->events) continue;
+        
+        char label[64];
+        if (ring->level < 2) snprintf(label, sizeof(label), "thread %d", ring->team_tid);
+        else snprintf(label, sizeof(label), "thread %d / equipo de %d", ring->team_tid, ring->outer_tid);
+        fprintf(out, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                "\"args\": {\"name\": \"%s\"}}, "
+                "{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                "\"args\": {\"sort_index\": %d}}",
+                first ? "" : ",", t, label, t, t);
+        first = 0;
+        lanes++;
+        
+        long long count = (ring->written < TRACE_RING_EVENTS) ? ring->written : TRACE_RING_EVENTS;
+        for (long long k = ring->written - count; k < ring->written; k++) {
+            const TraceEvent* ev = &ring->events[k % TRACE_RING_EVENTS];
+            fprintf(out, ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                    "\"ts\": %.3f, \"dur\": %.3f}",
+                    ev->name, ev->category, t,
+                    (ev->start - trace_origin) * 1e6, (ev->end - ev->start) * 1e6);
+        }
+        total += count;
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    
+    for (int t = 0; t < TRACE_MAX_LANES; t++) {
+        free(trace_rings[t].events);
+        trace_rings[t].events = NULL;
+    }
+    printf("Traza guardada en %s (%lld eventos, %d carriles)\n", trace_path, total, lanes);
+}
+
+// Perfilado por fase: cada fase guarda su duración en una ventana rodante
+// de PROFILE_WINDOW muestras, de la que salen min/prom/p50/p99/max.
+// phase_wall es el tiempo de pared de la fase (una muestra por ejecución);
+// phase_thread el trabajo de cada thread dentro de la región paralela,
+// sin contar esperas en barreras, para ver el desbalance de carga.
+enum {
+    PHASE_GRID,
+    PHASE_PHYSICS,
+    PHASE_INTERACTIONS,
+    PHASE_VERTICES,
+    PHASE_SUBMIT,
+    PHASE_SWAP,
+    PHASE_COUNT
+};
+static const char* phase_names[PHASE_COUNT] = {
+    "grid", "fisica", "interacciones", "vertices", "envio_gl", "swap"
+};
+
+#define PROFILE_WINDOW 512
+#define PROFILE_MAX_THREADS 64
+
+typedef struct {
+    float samples[PROFILE_WINDOW];  // Milisegundos, buffer circular
+    int next;
+    int filled;
+} PhaseSamples;
+
+typedef struct {
+    int samples;
+    float min, avg, p50, p99, max;
+} PhaseSummary;
+
+PhaseSamples phase_wall[PHASE_COUNT];
+PhaseSamples phase_thread[PHASE_COUNT][PROFILE_MAX_THREADS];
+const char* profile_prefix = NULL;  // --profile PREFIJO: volcar CSV/JSON al salir
+
+static inline void profile_add(PhaseSamples* ps, double seconds) {
+    ps->samples[ps->next] = (float)(seconds * 1000.0);
+    ps->next = (ps->next + 1) % PROFILE_WINDOW;
+    if (ps->filled < PROFILE_WINDOW) ps->filled++;
+}
+
+// Cierra el temporizador de una fase abierto con start = omp_get_wtime()
+static inline void profile_end(int phase, double start) {
+    double end = omp_get_wtime();
+    profile_add(&phase_wall[phase], end - start);
+    trace_event(phase_names[phase], "fase", start, end);
+}
+
+// Trabajo propio del thread que llama dentro de la fase
+static inline void profile_thread_add(int phase, double seconds) {
+    int tid = omp_get_thread_num();
+    if (tid < PROFILE_MAX_THREADS) profile_add(&phase_thread[phase][tid], seconds);
+}
+
+// Cierra un tramo de trabajo del thread dentro de la fase: lo traza y
+// devuelve su duración para el perfil
+static inline double trace_segment(int phase, double start) {
+    double end = omp_get_wtime();
+    trace_event(phase_names[phase], "bucle", start, end);
+    return end - start;
+}
+
+static int compare_floats(const void* a, const void* b) {
+    float fa = *(const float*)a;
+    float fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+static int summarize_phase(const PhaseSamples* ps, PhaseSummary* out) {
+    static float sorted[PROFILE_WINDOW];
+    int n = ps->filled;
+    if (n == 0) return 0;
+    
+    memcpy(sorted, ps->samples, n * sizeof(float));
+    qsort(sorted, n, sizeof(float), compare_floats);
+    
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += sorted[i];
+    
+    out->samples = n;
+    out->min = sorted[0];
+    out->avg = (float)(sum / n);
+    out->p50 = sorted[(n - 1) / 2];
+    out->p99 = sorted[(int)ceil(0.99 * n) - 1];
+    out->max = sorted[n - 1];
+    return 1;
+}
+
+// Vuelca las estadísticas a <prefijo>.csv y <prefijo>.json y las muestra
+void profile_dump(const char* prefix) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s.csv", prefix);
+    FILE* csv = fopen(path, "w");
+    snprintf(path, sizeof(path), "%s.json", prefix);
+    FILE* json = fopen(path, "w");
+    if (!csv || !json) {
+        printf("Error: No se pudo escribir el perfil en %s.csv / %s.json\n", prefix, prefix);
+        if (csv) fclose(csv);
+        if (json) fclose(json);
+        return;
+    }
+    
+    fprintf(csv, "fase,thread,muestras,min_ms,prom_ms,p50_ms,p99_ms,max_ms\n");
+    fprintf(json, "{\n  \"build\": \"paralelo1\",\n  \"ventana\": %d,\n  \"fases\": [", PROFILE_WINDOW);
+    printf("\n=== PERFIL POR FASE (últimas %d muestras, ms) ===\n", PROFILE_WINDOW);
+    printf("%-14s %-7s %8s %9s %9s %9s %9s %9s\n", "Fase", "Thread", "Muestras", "Min", "Prom", "P50", "P99", "Max");
+    
+    int first = 1;
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        for (int slot = -1; slot < PROFILE_MAX_THREADS; slot++) {
+            const PhaseSamples* ps = (slot < 0) ? &phase_wall[phase] : &phase_thread[phase][slot];
+            PhaseSummary st;
+            if (!summarize_phase(ps, &st)) continue;
+            
+            char thread_label[16];
+            if (slot < 0) snprintf(thread_label, sizeof(thread_label), "todos");
+            else snprintf(thread_label, sizeof(thread_label), "%d", slot);
+            
+            fprintf(csv, "%s,%s,%d,%.4f,%.4f,%.4f,%.4f,%.4f\n", phase_names[phase], thread_label,
+                    st.samples, st.min, st.avg, st.p50, st.p99, st.max);
+            fprintf(json, "%s\n    {\"fase\": \"%s\", \"thread\": \"%s\", \"muestras\": %d, "
+                    "\"min_ms\": %.4f, \"prom_ms\": %.4f, \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f}",
+                    first ? "" : ",", phase_names[phase], thread_label, st.samples,
+                    st.min, st.avg, st.p50, st.p99, st.max);
+            printf("%-14s %-7s %8d %9.4f %9.4f %9.4f %9.4f %9.4f\n", phase_names[phase], thread_label,
+                   st.samples, st.min, st.avg, st.p50, st.p99, st.max);
+            first = 0;
+        }
+    }
+    
+    fprintf(json, "\n  ]\n}\n");
+    fclose(csv);
+    fclose(json);
+    printf("Perfil guardado en %s.csv y %s.json\n", prefix, prefix);
+}
+
+// Generador pseudoaleatorio por estrella (SplitMix64): el flujo se deriva de
+// (semilla, índice de estrella), sin estado global compartido. Así la
+// inicialización escala con los threads y produce las mismas estrellas con
+// cualquier número de threads.
+typedef struct {
+    uint64_t state;
+} StarRng;
+
+uint64_t star_seed = 0;
+
+static inline uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline StarRng star_rng(int index) {
+    StarRng rng;
+    uint64_t key = star_seed ^ ((uint64_t)(uint32_t)index * 0xD1B54A32D192ED03ULL);
+    rng.state = splitmix64(&key);
+    return rng;
+}
+
+// Entero uniforme en [0, n)
+static inline int rng_range(StarRng* rng, int n) {
+    return (int)((splitmix64(&rng->state) >> 32) % (uint64_t)n);
+}
+
+void generate_star_color(Star* star, StarRng* rng) {
+    int color_type = rng_range(rng, 8);
     switch(color_type) {
-        case 0: star->r = 0.2f + (rand() % 30) / 100.0f; star->g = 0.4f + (rand() % 40) / 100.0f; star->b = 0.9f + (rand() % 10) / 100.0f; break;
-        case 1: star->r = 0.9f + (rand() % 10) / 100.0f; star->g = 0.2f + (rand() % 30) / 100.0f; star->b = 0.7f + (rand() % 30) / 100.0f; break;
-        case 2: star->r = 0.9f + (rand() % 10) / 100.0f; star->g = 0.8f + (rand() % 20) / 100.0f; star->b = 0.1f + (rand() % 20) / 100.0f; break;
-        case 3: star->r = 0.1f + (rand() % 20) / 100.0f; star->g = 0.8f + (rand() % 20) / 100.0f; star->b = 0.3f + (rand() % 30) / 100.0f; break;
-        case 4: star->r = 0.9f + (rand() % 10) / 100.0f; star->g = 0.5f + (rand() % 30) / 100.0f; star->b = 0.1f + (rand() % 20) / 100.0f; break;
-        case 5: star->r = 0.7f + (rand() % 30) / 100.0f; star->g = 0.2f + (rand() % 20) / 100.0f; star->b = 0.9f + (rand() % 10) / 100.0f; break;
-        case 6: star->r = 0.1f + (rand() % 20) / 100.0f; star->g = 0.8f + (rand() % 20) / 100.0f; star->b = 0.9f + (rand() % 10) / 100.0f; break;
-        default: star->r = star->g = star->b = 0.9f + (rand() % 10) / 100.0f; break;
+        case 0: star->r = 0.2f + rng_range(rng, 30) / 100.0f; star->g = 0.4f + rng_range(rng, 40) / 100.0f; star->b = 0.9f + rng_range(rng, 10) / 100.0f; break;
+        case 1: star->r = 0.9f + rng_range(rng, 10) / 100.0f; star->g = 0.2f + rng_range(rng, 30) / 100.0f; star->b = 0.7f + rng_range(rng, 30) / 100.0f; break;
+        case 2: star->r = 0.9f + rng_range(rng, 10) / 100.0f; star->g = 0.8f + rng_range(rng, 20) / 100.0f; star->b = 0.1f + rng_range(rng, 20) / 100.0f; break;
+        case 3: star->r = 0.1f + rng_range(rng, 20) / 100.0f; star->g = 0.8f + rng_range(rng, 20) / 100.0f; star->b = 0.3f + rng_range(rng, 30) / 100.0f; break;
+        case 4: star->r = 0.9f + rng_range(rng, 10) / 100.0f; star->g = 0.5f + rng_range(rng, 30) / 100.0f; star->b = 0.1f + rng_range(rng, 20) / 100.0f; break;
+        case 5: star->r = 0.7f + rng_range(rng, 30) / 100.0f; star->g = 0.2f + rng_range(rng, 20) / 100.0f; star->b = 0.9f + rng_range(rng, 10) / 100.0f; break;
+        case 6: star->r = 0.1f + rng_range(rng, 20) / 100.0f; star->g = 0.8f + rng_range(rng, 20) / 100.0f; star->b = 0.9f + rng_range(rng, 10) / 100.0f; break;
+        default: star->r = star->g = star->b = 0.9f + rng_range(rng, 10) / 100.0f; break;
     }
 }
 
 void init_star(Star* star, int index) {
-    star->x = (float)(rand() % WINDOW_WIDTH);
-    star->y = (float)(rand() % WINDOW_HEIGHT);
-    float angle = (float)(rand() % 360) * PI / 180.0f;
-    float speed = (float)(rand() % 30 + 10) / 1000.0f;
+    StarRng rng = star_rng(index);
+    star->x = (float)rng_range(&rng, WINDOW_WIDTH);
+    star->y = (float)rng_range(&rng, WINDOW_HEIGHT);
+    star->prev_x = star->x;
+    star->prev_y = star->y;
+    float angle = (float)rng_range(&rng, 360) * PI / 180.0f;
+    float speed = (float)(rng_range(&rng, 30) + 10) / 1000.0f;
     star->vx = cos(angle) * speed;
     star->vy = sin(angle) * speed;
-    star->brightness = 0.6f + (float)(rand() % 40) / 100.0f;
-    star->pulse_phase = (float)(rand() % 360) * PI / 180.0f;
-    star->pulse_speed = (float)(rand() % 20 + 5) / 10000.0f;
-    star->size = 2.0f + (float)(rand() % 6);
-    star->star_type = rand() % 4;
-    star->glow_intensity = 0.5f + (float)(rand() % 50) / 100.0f;
-    generate_star_color(star);
+    star->brightness = 0.6f + (float)rng_range(&rng, 40) / 100.0f;
+    star->pulse_phase = (float)rng_range(&rng, 360) * PI / 180.0f;
+    star->pulse_speed = (float)(rng_range(&rng, 20) + 5) / 10000.0f;
+    star->size = 2.0f + (float)rng_range(&rng, 6);
+    star->star_type = rng_range(&rng, 4);
+    star->glow_intensity = 0.5f + (float)rng_range(&rng, 50) / 100.0f;
+    generate_star_color(star, &rng);
+}
+
+// Capacidad por duplicación: agregar estrellas cuesta O(1) amortizado
+int reserve_stars(int needed) {
+    if (needed <= stars_capacity) return 1;
+    int new_capacity = (stars_capacity > 0) ? stars_capacity : 64;
+    while (new_capacity < needed)
+        new_capacity = (new_capacity > MAX_STARS / 2) ? MAX_STARS : new_capacity * 2;
+    Star* new_stars = (Star*)realloc(stars, (size_t)new_capacity * sizeof(Star));
+    if (!new_stars) return 0;
+    stars = new_stars;
+    stars_capacity = new_capacity;
+    return 1;
+}
+
+// Snapshots binarios (--load / --save): mismo formato que los otros builds,
+// cabecera de una página y columnas con el layout SoA de paralelo2; las
+// estrellas se transponen en paralelo al guardar y al cargar.
+#define SNAPSHOT_MAGIC "STARSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_BYTES 4096   // Una página: las columnas quedan alineadas para mmap
+#define SNAPSHOT_ENDIAN_TAG 0x01020304u
+#define SNAPSHOT_COLUMNS 16
+
+// Orden de las columnas en el archivo (el de la arena de paralelo2)
+enum {
+    COL_X, COL_Y, COL_VX, COL_VY, COL_BRIGHTNESS, COL_PULSE_PHASE, COL_PULSE_SPEED, COL_SIZE,
+    COL_R, COL_G, COL_B, COL_GLOW, COL_TYPE, COL_GRID_CELL, COL_PREV_X, COL_PREV_Y
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_tag;      // Detecta archivos de otra arquitectura
+    uint32_t header_bytes;    // Desplazamiento de la primera columna
+    uint32_t column_count;
+    uint64_t column_stride;   // Bytes por columna (múltiplo de 64)
+    uint64_t star_count;
+    uint64_t seed;
+    uint64_t sim_steps;
+    uint32_t world_width;
+    uint32_t world_height;
+} SnapshotHeader;
+
+const char* snapshot_load_path = NULL;  // --load ARCHIVO
+const char* snapshot_save_path = NULL;  // --save ARCHIVO (al salir; también tecla S)
+
+static void fill_snapshot_header(char* block, int count, size_t stride) {
+    memset(block, 0, SNAPSHOT_HEADER_BYTES);
+    SnapshotHeader* header = (SnapshotHeader*)block;
+    memcpy(header->magic, SNAPSHOT_MAGIC, 8);
+    header->version = SNAPSHOT_VERSION;
+    header->endian_tag = SNAPSHOT_ENDIAN_TAG;
+    header->header_bytes = SNAPSHOT_HEADER_BYTES;
+    header->column_count = SNAPSHOT_COLUMNS;
+    header->column_stride = stride;
+    header->star_count = (uint64_t)count;
+    header->seed = star_seed;
+    header->sim_steps = (uint64_t)sim_steps;
+    header->world_width = WINDOW_WIDTH;
+    header->world_height = WINDOW_HEIGHT;
+}
+
+static int check_snapshot_header(const SnapshotHeader* header, size_t file_bytes) {
+    if (file_bytes < sizeof(SnapshotHeader) || memcmp(header->magic, SNAPSHOT_MAGIC, 8) != 0) {
+        printf("Error: El archivo no es un snapshot de estrellas\n");
+        return 0;
+    }
+    if (header->version != SNAPSHOT_VERSION || header->endian_tag != SNAPSHOT_ENDIAN_TAG) {
+        printf("Error: Snapshot versión %u incompatible (se espera %d, mismo orden de bytes)\n",
+               header->version, SNAPSHOT_VERSION);
+        return 0;
+    }
+    // Límites sin sumas ni productos de campos del archivo: un column_stride
+    // manipulado podría desbordar header_bytes + stride * columnas
+    if (header->column_count != SNAPSHOT_COLUMNS || header->header_bytes < sizeof(SnapshotHeader) ||
+        header->column_stride % 64 != 0 || header->star_count == 0 || header->star_count > MAX_STARS ||
+        header->star_count * 4 > header->column_stride || header->column_stride / 4 > MAX_STARS ||
+        header->header_bytes > file_bytes ||
+        header->column_stride > (file_bytes - header->header_bytes) / SNAPSHOT_COLUMNS) {
+        printf("Error: Snapshot corrupto o truncado\n");
+        return 0;
+    }
+    if (header->world_width != WINDOW_WIDTH || header->world_height != WINDOW_HEIGHT) {
+        printf("Advertencia: Snapshot de un mundo de %ux%u\n", header->world_width, header->world_height);
+    }
+    return 1;
+}
+
+// Cabecera y columnas con un solo writev (fwrite en Windows)
+static int write_snapshot_file(const char* path, char* header_block, char* columns, size_t columns_bytes) {
+#ifdef _WIN32
+    FILE* out = fopen(path, "wb");
+    if (!out) return 0;
+    int ok = fwrite(header_block, 1, SNAPSHOT_HEADER_BYTES, out) == SNAPSHOT_HEADER_BYTES &&
+             fwrite(columns, 1, columns_bytes, out) == columns_bytes;
+    return (fclose(out) == 0) && ok;
+#else
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return 0;
+    struct iovec iov[2] = {
+        { header_block, SNAPSHOT_HEADER_BYTES },
+        { columns, columns_bytes }
+    };
+    int first = 0;
+    while (first < 2) {
+        // writev puede escribir menos de lo pedido con archivos muy grandes
+        ssize_t written = writev(fd, &iov[first], 2 - first);
+        if (written < 0) {
+            close(fd);
+            return 0;
+        }
+        while (first < 2 && (size_t)written >= iov[first].iov_len) {
+            written -= iov[first].iov_len;
+            first++;
+        }
+        if (first < 2) {
+            iov[first].iov_base = (char*)iov[first].iov_base + written;
+            iov[first].iov_len -= written;
+        }
+    }
+    return close(fd) == 0;
+#endif
+}
+
+// Mapea el archivo completo en solo lectura (en Windows se lee a memoria)
+static const char* map_snapshot_file(const char* path, size_t* bytes) {
+#ifdef _WIN32
+    FILE* in = fopen(path, "rb");
+    if (!in) return NULL;
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    char* data = (size > 0) ? (char*)malloc(size) : NULL;
+    if (data && fread(data, 1, size, in) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(in);
+    *bytes = (size_t)size;
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+    *bytes = (size_t)st.st_size;
+    return (const char*)data;
+#endif
+}
+
+static void unmap_snapshot_file(const char* data, size_t bytes) {
+#ifdef _WIN32
+    (void)bytes;
+    free((void*)data);
+#else
+    munmap((void*)data, bytes);
+#endif
+}
+
+// Transpone las estrellas a columnas y las guarda
+int save_snapshot(const char* path) {
+    int n = num_stars;
+    size_t stride = (((size_t)n + 15) / 16 * 16) * 4;
+    char* columns = (char*)calloc(SNAPSHOT_COLUMNS, stride);
+    if (!columns) {
+        printf("Error: No se pudo asignar memoria para el snapshot\n");
+        return 0;
+    }
+    
+    #define SNAP_COLUMN(type, k) ((type*)(columns + (size_t)(k) * stride))
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        const Star* star = &stars[i];
+        SNAP_COLUMN(float, COL_X)[i] = star->x;
+        SNAP_COLUMN(float, COL_Y)[i] = star->y;
+        SNAP_COLUMN(float, COL_VX)[i] = star->vx;
+        SNAP_COLUMN(float, COL_VY)[i] = star->vy;
+        SNAP_COLUMN(float, COL_BRIGHTNESS)[i] = star->brightness;
+        SNAP_COLUMN(float, COL_PULSE_PHASE)[i] = star->pulse_phase;
+        SNAP_COLUMN(float, COL_PULSE_SPEED)[i] = star->pulse_speed;
+        SNAP_COLUMN(float, COL_SIZE)[i] = star->size;
+        SNAP_COLUMN(float, COL_R)[i] = star->r;
+        SNAP_COLUMN(float, COL_G)[i] = star->g;
+        SNAP_COLUMN(float, COL_B)[i] = star->b;
+        SNAP_COLUMN(float, COL_GLOW)[i] = star->glow_intensity;
+        SNAP_COLUMN(int, COL_TYPE)[i] = star->star_type;
+        SNAP_COLUMN(float, COL_PREV_X)[i] = star->prev_x;
+        SNAP_COLUMN(float, COL_PREV_Y)[i] = star->prev_y;
+    }
+    #undef SNAP_COLUMN
+    
+    char header_block[SNAPSHOT_HEADER_BYTES];
+    fill_snapshot_header(header_block, n, stride);
+    int ok = write_snapshot_file(path, header_block, columns, stride * SNAPSHOT_COLUMNS);
+    free(columns);
+    
+    if (ok) printf("Snapshot guardado en %s (%d estrellas, paso %lld)\n", path, n, sim_steps);
+    else printf("Error: No se pudo escribir el snapshot %s\n", path);
+    return ok;
+}
+
+// Carga un snapshot sobre el arreglo de estrellas; devuelve la cantidad o -1
+int load_snapshot(const char* path) {
+    size_t bytes = 0;
+    const char* data = map_snapshot_file(path, &bytes);
+    if (!data) {
+        printf("Error: No se pudo abrir el snapshot %s\n", path);
+        return -1;
+    }
+    const SnapshotHeader* header = (const SnapshotHeader*)data;
+    if (!check_snapshot_header(header, bytes)) {
+        unmap_snapshot_file(data, bytes);
+        return -1;
+    }
+    
+    int n = (int)header->star_count;
+    if (!reserve_stars(n)) {
+        printf("Error: No se pudo asignar memoria para %d estrellas\n", n);
+        unmap_snapshot_file(data, bytes);
+        return -1;
+    }
+    
+    const char* columns = data + header->header_bytes;
+    size_t stride = header->column_stride;
+    #define SNAP_COLUMN(type, k) ((const type*)(columns + (size_t)(k) * stride))
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        Star* star = &stars[i];
+        star->x = SNAP_COLUMN(float, COL_X)[i];
+        star->y = SNAP_COLUMN(float, COL_Y)[i];
+        star->vx = SNAP_COLUMN(float, COL_VX)[i];
+        star->vy = SNAP_COLUMN(float, COL_VY)[i];
+        star->brightness = SNAP_COLUMN(float, COL_BRIGHTNESS)[i];
+        star->pulse_phase = SNAP_COLUMN(float, COL_PULSE_PHASE)[i];
+        star->pulse_speed = SNAP_COLUMN(float, COL_PULSE_SPEED)[i];
+        star->size = SNAP_COLUMN(float, COL_SIZE)[i];
+        star->r = SNAP_COLUMN(float, COL_R)[i];
+        star->g = SNAP_COLUMN(float, COL_G)[i];
+        star->b = SNAP_COLUMN(float, COL_B)[i];
+        star->glow_intensity = SNAP_COLUMN(float, COL_GLOW)[i];
+        star->star_type = SNAP_COLUMN(int, COL_TYPE)[i] & 3;
+        star->prev_x = SNAP_COLUMN(float, COL_PREV_X)[i];
+        star->prev_y = SNAP_COLUMN(float, COL_PREV_Y)[i];
+    }
+    #undef SNAP_COLUMN
+    
+    star_seed = header->seed;
+    sim_steps = (long long)header->sim_steps;
+    unmap_snapshot_file(data, bytes);
+    return n;
+}
+
+// Regresión (--compare GOLDEN): deriva de x, y, vx, vy respecto de un
+// snapshot de referencia al terminar el benchmark headless. El proceso sale
+// con código 2 si la deriva máxima supera --tolerance o el paso no coincide.
+const char* compare_path = NULL;
+double compare_tolerance = 1e-3;
+
+typedef struct {
+    double max;
+    double sum_sq;
+} Drift;
+
+static inline void drift_add(Drift* drift, float value, float golden) {
+    double d = fabs((double)value - (double)golden);
+    if (!(d <= drift->max)) drift->max = d;  // Un NaN también queda como máximo
+    drift->sum_sq += d * d;
+}
+
+// Imprime la deriva por columna; 1 si todo queda dentro de la tolerancia
+static int report_drift(const char* path, const Drift drift[4], int n, uint64_t golden_steps) {
+    static const char* names[4] = { "x", "y", "vx", "vy" };
+    double worst = 0.0;
+    
+    printf("Comparación con %s (%d estrellas, paso %lld, golden en el paso %llu):\n",
+           path, n, sim_steps, (unsigned long long)golden_steps);
+    for (int k = 0; k < 4; k++) {
+        printf("  %-2s  máx %.3e | rms %.3e\n", names[k], drift[k].max, sqrt(drift[k].sum_sq / n));
+        if (!(drift[k].max <= worst)) worst = drift[k].max;
+    }
+    int ok = (uint64_t)sim_steps == golden_steps && worst <= compare_tolerance;
+    printf("Deriva máxima: %.3e (tolerancia %.1e) -> %s\n", worst, compare_tolerance, ok ? "OK" : "FALLA");
+    return ok;
+}
+
+int compare_snapshot(const char* path) {
+    size_t bytes = 0;
+    const char* data = map_snapshot_file(path, &bytes);
+    if (!data) {
+        printf("Error: No se pudo abrir el snapshot golden %s\n", path);
+        return 0;
+    }
+    const SnapshotHeader* header = (const SnapshotHeader*)data;
+    if (!check_snapshot_header(header, bytes)) {
+        unmap_snapshot_file(data, bytes);
+        return 0;
+    }
+    if ((int)header->star_count != num_stars) {
+        printf("Error: El golden tiene %llu estrellas y la simulación %d\n",
+               (unsigned long long)header->star_count, num_stars);
+        unmap_snapshot_file(data, bytes);
+        return 0;
+    }
+    
+    const char* columns = data + header->header_bytes;
+    const float* golden_x = (const float*)(columns + (size_t)COL_X * header->column_stride);
+    const float* golden_y = (const float*)(columns + (size_t)COL_Y * header->column_stride);
+    const float* golden_vx = (const float*)(columns + (size_t)COL_VX * header->column_stride);
+    const float* golden_vy = (const float*)(columns + (size_t)COL_VY * header->column_stride);
+    Drift drift[4];
+    memset(drift, 0, sizeof(drift));
+    for (int i = 0; i < num_stars; i++) {
+        drift_add(&drift[0], stars[i].x, golden_x[i]);
+        drift_add(&drift[1], stars[i].y, golden_y[i]);
+        drift_add(&drift[2], stars[i].vx, golden_vx[i]);
+        drift_add(&drift[3], stars[i].vy, golden_vy[i]);
+    }
+    
+    int ok = report_drift(path, drift, num_stars, header->sim_steps);
+    unmap_snapshot_file(data, bytes);
+    return ok;
+}
+
+// Grabación de trayectorias (--record ARCHIVO). Tras cada paso de física
+// record_frame() copia las posiciones (y con --record-colors color y brillo)
+// a uno de dos bloques en memoria; un thread escritor codifica y escribe el
+// bloque lleno mientras la simulación llena el otro. La simulación nunca
+// espera al disco: si el escritor sigue ocupado con el otro bloque, el frame
+// se descarta y se cuenta en la cabecera.
+//
+// Archivo: RecordHeader y luego, por frame, RecordFrameHeader + columnas
+// x[n], y[n] (y con color r[n] g[n] b[n] brillo[n], un byte cada uno):
+//   raw:   x, y como float
+//   q16:   x, y cuantizadas a uint16 sobre el ancho/alto del mundo
+//   delta: q16 completo cada RECORD_KEYFRAME_INTERVAL frames o si cambia el
+//          número de estrellas; el resto, diferencia con el frame anterior
+//          en zigzag + varint (1-3 bytes por coordenada)
+#define RECORD_MAGIC "STARREC"
+#define RECORD_VERSION 1
+#define RECORD_BLOCK_BYTES (4 << 20)  // Tamaño de cada bloque (crece si un frame no cabe)
+#define RECORD_KEYFRAME_INTERVAL 60
+#define RECORD_FLAG_COLORS 1u
+
+enum { RECORD_RAW, RECORD_Q16, RECORD_DELTA };
+static const char* record_encoding_names[] = { "raw", "q16", "delta" };
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_tag;
+    uint32_t encoding;
+    uint32_t flags;
+    uint32_t world_width;
+    uint32_t world_height;
+    uint32_t keyframe_interval;
+    uint32_t frame_header_bytes;
+    uint64_t seed;
+    double dt;
+    uint64_t frames;   // frames y dropped se completan al cerrar
+    uint64_t dropped;
+} RecordHeader;
+
+typedef struct {
+    uint64_t step;
+    uint32_t star_count;
+    uint32_t keyframe;        // 0 = delta respecto del frame anterior
+    uint64_t payload_bytes;
+} RecordFrameHeader;
+
+// Frames preparados por la simulación, aún sin codificar
+typedef struct {
+    unsigned char* data;
+    size_t used, capacity;
+} RecordBlock;
+
+typedef struct {
+    FILE* file;
+    RecordBlock blocks[2];
+    RecordBlock* active;      // Lo llena la simulación
+    RecordBlock* pending;     // Entregado al escritor; NULL si está libre
+    int closing;
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;      // Hay bloque pendiente o hay que cerrar
+    pthread_cond_t idle;      // El escritor terminó el bloque pendiente
+    uint64_t frames, dropped;
+    
+    // Estado del escritor: solo lo toca su thread
+    uint16_t* previous;       // Último frame cuantizado (x luego y), para delta
+    int previous_count;
+    uint64_t encoded_frames;
+    unsigned char* encoded;
+    size_t encoded_capacity;
+    uint64_t bytes_written, raw_bytes;
+    double write_seconds;
+    int write_error;
+} Recorder;
+
+Recorder recorder;
+const char* record_path = NULL;
+int record_encoding = RECORD_DELTA;
+int record_colors = 0;
+
+int parse_record_encoding(const char* text) {
+    for (int k = 0; k < 3; k++) {
+        if (strcmp(text, record_encoding_names[k]) == 0) {
+            record_encoding = k;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Bytes de un frame preparado (cabecera + columnas), redondeado a 8
+static size_t record_staged_bytes(int n) {
+    size_t coords = (size_t)n * (record_encoding == RECORD_RAW ? 2 * sizeof(float) : 2 * sizeof(uint16_t));
+    size_t colors = record_colors ? (size_t)n * 4 : 0;
+    return (sizeof(RecordFrameHeader) + coords + colors + 7) & ~(size_t)7;
+}
+
+static inline uint16_t record_quantize(float value, float extent) {
+    float q = value * (65535.0f / extent) + 0.5f;
+    if (q < 0.0f) q = 0.0f;
+    if (q > 65535.0f) q = 65535.0f;
+    return (uint16_t)q;
+}
+
+static inline uint8_t record_unit_byte(float value) {
+    float q = value * 255.0f + 0.5f;
+    if (q < 0.0f) q = 0.0f;
+    if (q > 255.0f) q = 255.0f;
+    return (uint8_t)q;
+}
+
+// Copia el estado de stars al frame preparado: columnas de posición
+// (float o cuantizadas) y, con color, r g b y brillo actual del pulso
+static void record_stage(unsigned char* payload, int n) {
+    int raw = record_encoding == RECORD_RAW;
+    float* fx = (float*)payload;
+    uint16_t* qx = (uint16_t*)payload;
+    unsigned char* color = payload + (size_t)n * (raw ? 8 : 4);
+    
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        if (raw) {
+            fx[i] = stars[i].x;
+            fx[n + i] = stars[i].y;
+        } else {
+            qx[i] = record_quantize(stars[i].x, (float)WINDOW_WIDTH);
+            qx[n + i] = record_quantize(stars[i].y, (float)WINDOW_HEIGHT);
+        }
+        if (record_colors) {
+            color[i] = record_unit_byte(stars[i].r);
+            color[n + i] = record_unit_byte(stars[i].g);
+            color[2 * n + i] = record_unit_byte(stars[i].b);
+            color[3 * n + i] = record_unit_byte(stars[i].brightness * (0.7f + 0.3f * sinf(stars[i].pulse_phase)));
+        }
+    }
+}
+
+// Diferencias con el frame anterior en zigzag + varint; actualiza previous
+static size_t record_encode_delta(const uint16_t* q, int values, unsigned char* out) {
+    uint16_t* previous = recorder.previous;
+    size_t k = 0;
+    for (int i = 0; i < values; i++) {
+        int16_t delta = (int16_t)(uint16_t)(q[i] - previous[i]);
+        uint16_t z = (uint16_t)((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15);
+        while (z >= 0x80) {
+            out[k++] = (unsigned char)(z | 0x80);
+            z >>= 7;
+        }
+        out[k++] = (unsigned char)z;
+        previous[i] = q[i];
+    }
+    return k;
+}
+
+// Codifica y escribe los frames de un bloque (thread escritor)
+static void record_write_block(const RecordBlock* block) {
+    double start = omp_get_wtime();
+    size_t offset = 0;
+    
+    while (offset < block->used && !recorder.write_error) {
+        RecordFrameHeader header;
+        memcpy(&header, block->data + offset, sizeof(header));
+        int n = (int)header.star_count;
+        const unsigned char* payload = block->data + offset + sizeof(header);
+        size_t coord_bytes = (size_t)n * (record_encoding == RECORD_RAW ? 8 : 4);
+        size_t color_bytes = record_colors ? (size_t)n * 4 : 0;
+        offset += record_staged_bytes(n);
+        
+        const unsigned char* coords = payload;
+        size_t coords_out = coord_bytes;
+        if (record_encoding == RECORD_DELTA) {
+            int keyframe = n != recorder.previous_count ||
+                           recorder.encoded_frames % RECORD_KEYFRAME_INTERVAL == 0;
+            if (keyframe) {
+                uint16_t* previous = (uint16_t*)realloc(recorder.previous, coord_bytes + 1);
+                if (!previous) {
+                    recorder.write_error = 1;
+                    break;
+                }
+                recorder.previous = previous;
+                recorder.previous_count = n;
+                memcpy(previous, payload, coord_bytes);
+            } else {
+                size_t worst = (size_t)n * 2 * 3;
+                if (worst > recorder.encoded_capacity) {
+                    unsigned char* encoded = (unsigned char*)realloc(recorder.encoded, worst);
+                    if (!encoded) {
+                        recorder.write_error = 1;
+                        break;
+                    }
+                    recorder.encoded = encoded;
+                    recorder.encoded_capacity = worst;
+                }
+                coords_out = record_encode_delta((const uint16_t*)payload, 2 * n, recorder.encoded);
+                coords = recorder.encoded;
+            }
+            header.keyframe = keyframe;
+        }
+        recorder.encoded_frames++;
+        header.payload_bytes = coords_out + color_bytes;
+        
+        if (fwrite(&header, sizeof(header), 1, recorder.file) != 1 ||
+            fwrite(coords, 1, coords_out, recorder.file) != coords_out ||
+            fwrite(payload + coord_bytes, 1, color_bytes, recorder.file) != color_bytes) {
+            recorder.write_error = 1;
+        }
+        recorder.bytes_written += sizeof(header) + header.payload_bytes;
+        recorder.raw_bytes += sizeof(header) + (size_t)n * (record_colors ? 6 : 2) * sizeof(float);
+    }
+    recorder.write_seconds += omp_get_wtime() - start;
+}
+
+static void* record_writer(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&recorder.lock);
+    for (;;) {
+        while (!recorder.pending && !recorder.closing) {
+            pthread_cond_wait(&recorder.wake, &recorder.lock);
+        }
+        if (!recorder.pending) break;
+        
+        RecordBlock* block = recorder.pending;
+        pthread_mutex_unlock(&recorder.lock);
+        record_write_block(block);
+        block->used = 0;
+        pthread_mutex_lock(&recorder.lock);
+        recorder.pending = NULL;
+        pthread_cond_signal(&recorder.idle);
+    }
+    pthread_mutex_unlock(&recorder.lock);
+    return NULL;
+}
+
+int record_begin(const char* path) {
+    memset(&recorder, 0, sizeof(recorder));
+    recorder.file = fopen(path, "wb");
+    if (!recorder.file) {
+        printf("Error: No se pudo crear la grabación %s\n", path);
+        return 0;
+    }
+    
+    RecordHeader header;
+    memset(&header, 0, sizeof(header));  // Se reescribe al cerrar
+    for (int k = 0; k < 2; k++) {
+        recorder.blocks[k].data = (unsigned char*)malloc(RECORD_BLOCK_BYTES);
+        recorder.blocks[k].capacity = RECORD_BLOCK_BYTES;
+    }
+    if (!recorder.blocks[0].data || !recorder.blocks[1].data ||
+        fwrite(&header, sizeof(header), 1, recorder.file) != 1) {
+        printf("Error: No se pudo iniciar la grabación %s\n", path);
+        free(recorder.blocks[0].data);
+        free(recorder.blocks[1].data);
+        fclose(recorder.file);
+        recorder.file = NULL;
+        return 0;
+    }
+    recorder.active = &recorder.blocks[0];
+    
+    pthread_mutex_init(&recorder.lock, NULL);
+    pthread_cond_init(&recorder.wake, NULL);
+    pthread_cond_init(&recorder.idle, NULL);
+    if (pthread_create(&recorder.writer, NULL, record_writer, NULL) != 0) {
+        printf("Error: No se pudo crear el thread escritor de la grabación\n");
+        pthread_mutex_destroy(&recorder.lock);
+        pthread_cond_destroy(&recorder.wake);
+        pthread_cond_destroy(&recorder.idle);
+        free(recorder.blocks[0].data);
+        free(recorder.blocks[1].data);
+        fclose(recorder.file);
+        recorder.file = NULL;
+        return 0;
+    }
+    printf("Grabando trayectorias en %s (codificación %s%s)\n",
+           path, record_encoding_names[record_encoding], record_colors ? ", con color" : "");
+    return 1;
+}
+
+// Prepara el frame actual en el bloque activo; entrega el bloque al escritor
+// cuando se llena. Nunca espera: si el escritor está ocupado descarta el frame.
+void record_frame(int n) {
+    if (!recorder.file) return;
+    size_t need = record_staged_bytes(n);
+    RecordBlock* block = recorder.active;
+    
+    if (block->used + need > block->capacity) {
+        if (block->used > 0) {
+            pthread_mutex_lock(&recorder.lock);
+            int busy = recorder.pending != NULL;
+            if (!busy) {
+                recorder.pending = block;
+                recorder.active = (block == &recorder.blocks[0]) ? &recorder.blocks[1] : &recorder.blocks[0];
+                pthread_cond_signal(&recorder.wake);
+            }
+            pthread_mutex_unlock(&recorder.lock);
+            if (busy) {
+                recorder.dropped++;
+                return;
+            }
+            block = recorder.active;
+        }
+        if (need > block->capacity) {
+            // Un solo frame más grande que el bloque: crecer (memoria, no E/S)
+            unsigned char* data = (unsigned char*)realloc(block->data, need);
+            if (!data) {
+                recorder.dropped++;
+                return;
+            }
+            block->data = data;
+            block->capacity = need;
+        }
+    }
+    
+    RecordFrameHeader header = { (uint64_t)sim_steps, (uint32_t)n, 1, 0 };
+    memcpy(block->data + block->used, &header, sizeof(header));
+    record_stage(block->data + block->used + sizeof(header), n);
+    block->used += need;
+    recorder.frames++;
+}
+
+// Entrega el último bloque, espera al escritor y completa la cabecera
+void record_end() {
+    if (!recorder.file) return;
+    
+    pthread_mutex_lock(&recorder.lock);
+    while (recorder.pending) {
+        pthread_cond_wait(&recorder.idle, &recorder.lock);
+    }
+    if (recorder.active->used > 0) recorder.pending = recorder.active;
+    recorder.closing = 1;
+    pthread_cond_signal(&recorder.wake);
+    pthread_mutex_unlock(&recorder.lock);
+    pthread_join(recorder.writer, NULL);
+    
+    RecordHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+    header.version = RECORD_VERSION;
+    header.endian_tag = SNAPSHOT_ENDIAN_TAG;
+    header.encoding = (uint32_t)record_encoding;
+    header.flags = record_colors ? RECORD_FLAG_COLORS : 0;
+    header.world_width = WINDOW_WIDTH;
+    header.world_height = WINDOW_HEIGHT;
+    header.keyframe_interval = RECORD_KEYFRAME_INTERVAL;
+    header.frame_header_bytes = sizeof(RecordFrameHeader);
+    header.seed = star_seed;
+    header.dt = SIM_DT;
+    header.frames = recorder.encoded_frames;
+    header.dropped = recorder.dropped;
+    if (fseek(recorder.file, 0, SEEK_SET) != 0) {
+        printf("Advertencia: La salida no es posicionable; frames y descartados quedan en 0 en la cabecera\n");
+    } else if (fwrite(&header, sizeof(header), 1, recorder.file) != 1) {
+        recorder.write_error = 1;
+    }
+    if (fclose(recorder.file) != 0) recorder.write_error = 1;
+    recorder.file = NULL;
+    
+    if (recorder.write_error) printf("Error: La grabación quedó incompleta (falló la escritura)\n");
+    printf("Grabación: %llu frames (%llu descartados) | %.2f MB (%.1f%% de float) | escritor %.3f s, %.1f MB/s\n",
+           (unsigned long long)recorder.encoded_frames, (unsigned long long)recorder.dropped,
+           recorder.bytes_written / (1024.0 * 1024.0),
+           recorder.raw_bytes ? 100.0 * recorder.bytes_written / recorder.raw_bytes : 0.0,
+           recorder.write_seconds,
+           recorder.write_seconds > 0 ? recorder.bytes_written / (1024.0 * 1024.0) / recorder.write_seconds : 0.0);
+    
+    pthread_mutex_destroy(&recorder.lock);
+    pthread_cond_destroy(&recorder.wake);
+    pthread_cond_destroy(&recorder.idle);
+    free(recorder.blocks[0].data);
+    free(recorder.blocks[1].data);
+    free(recorder.previous);
+    free(recorder.encoded);
 }
 
 void apply_physics(Star* star) {
+    star->prev_x = star->x;
+    star->prev_y = star->y;
     star->x += star->vx;
     star->y += star->vy;
     if (star->x <= star->size || star->x >= WINDOW_WIDTH - star->size) {
@@ -94,131 +1162,511 @@ void apply_physics(Star* star) {
     }
 }
 
-void draw_star_glow(float x, float y, float size, float r, float g, float b, float alpha) {
-    int segments = 16;
-    glBegin(GL_TRIANGLE_FAN);
-    glColor4f(r, g, b, alpha);
-    glVertex2f(x, y);
-    for (int i = 0; i <= segments; i++) {
-        float angle = 2.0f * PI * i / segments;
-        float px = x + cos(angle) * size;
-        float py = y + sin(angle) * size;
-        glColor4f(r, g, b, 0.0f);
-        glVertex2f(px, py);
+// Vértice intercalado (posición + color RGBA) para arreglos de vértices
+typedef struct {
+    float x, y;
+    float r, g, b, a;
+} Vertex;
+
+// Vértice de sprite (posición + coordenada en el atlas + color RGBA)
+typedef struct {
+    float x, y;
+    float u, v;
+    float r, g, b, a;
+} SpriteVertex;
+
+// Buffer de vértices persistente: se reutiliza frame a frame y solo crece
+typedef struct {
+    Vertex* vertices;
+    int vertex_count;
+    int vertex_capacity;
+} VertexBuffer;
+
+typedef struct {
+    SpriteVertex* vertices;
+    int vertex_count;
+    int vertex_capacity;
+} SpriteBuffer;
+
+// Un buffer por tipo de primitiva; se dibujan con un puñado de draw calls
+typedef struct {
+    SpriteBuffer glow;       // GL_QUADS: sprites de brillo del atlas
+    VertexBuffer lines;      // GL_LINES: cruces, diagonales, rayos y contornos
+    VertexBuffer points[3];  // GL_POINTS de tamaño 3, 4 y 5 (tipos 0, 1 y 2)
+} RenderBatch;
+
+// Posición de escritura dentro de cada buffer del lote
+typedef struct {
+    int glow;
+    int line;
+    int point[3];
+} BatchCursor;
+
+// Atlas de brillo: una celda por tipo de estrella con la suma de todas sus
+// capas (cada capa baja linealmente de su alpha en el centro a 0 en su
+// radio). Las capas de un tipo escalan todas con size, así que un quad
+// del radio de la capa mayor las reemplaza: 4 vértices por estrella en vez
+// de un abanico de 17 vértices por capa.
+#define GLOW_ATLAS_CELL 64
+#define GLOW_ATLAS_WIDTH (GLOW_ATLAS_CELL * 4)
+#define GLOW_MAX_LAYERS 3
+#define GLOW_QUAD_VERTICES 4
+
+// Capas de brillo por tipo: radio en unidades de size y alpha por glow_intensity
+static const int glow_layers_by_type[4] = { 2, 1, 3, 2 };
+static const float glow_layer_radius[4][GLOW_MAX_LAYERS] = {
+    { 3.0f, 2.0f }, { 4.0f }, { 5.0f, 3.0f, 1.5f }, { 6.0f, 3.0f }
+};
+static const float glow_layer_alpha[4][GLOW_MAX_LAYERS] = {
+    { 0.1f, 0.2f }, { 0.15f }, { 0.08f, 0.15f, 0.3f }, { 0.05f, 0.1f }
+};
+
+unsigned char glow_atlas[GLOW_ATLAS_CELL][GLOW_ATLAS_WIDTH];  // GL_ALPHA, fila 0 en v = 0
+float glow_sprite_radius[4];       // Radio del quad (capa mayor) en unidades de size
+float glow_sprite_alpha[4];        // Alpha en el centro (suma de capas) por glow_intensity
+float glow_sprite_u0[4], glow_sprite_u1[4];
+float glow_sprite_v0, glow_sprite_v1;
+GLuint glow_texture = 0;
+
+// Vértices de línea fijos por tipo de estrella
+static const int line_vertices_by_type[4] = { 4, 8, 16, 20 };
+
+// Tablas del círculo unitario para los ángulos fijos de la geometría:
+// las formas se construyen con escala y desplazamiento, sin llamar a libm
+#define RAY_COUNT 8
+#define SHAPE_POINTS 10
+
+float ray_cos[RAY_COUNT], ray_sin[RAY_COUNT];
+float ray_phase_cos[RAY_COUNT], ray_phase_sin[RAY_COUNT];  // cos(i), sin(i) para sin(fase + i)
+float shape_cos[SHAPE_POINTS], shape_sin[SHAPE_POINTS];
+
+void init_trig_tables() {
+    for (int i = 0; i < RAY_COUNT; i++) {
+        ray_cos[i] = (float)cos(2.0 * PI * i / RAY_COUNT);
+        ray_sin[i] = (float)sin(2.0 * PI * i / RAY_COUNT);
+        ray_phase_cos[i] = (float)cos((double)i);
+        ray_phase_sin[i] = (float)sin((double)i);
+    }
+    for (int i = 0; i < SHAPE_POINTS; i++) {
+        shape_cos[i] = (float)cos(2.0 * PI * i / SHAPE_POINTS);
+        shape_sin[i] = (float)sin(2.0 * PI * i / SHAPE_POINTS);
+    }
+}
+
+// Calcula el perfil radial de cada celda del atlas. Los texels del borde de
+// la celda caen justo sobre el radio del quad (alpha 0) y las coordenadas
+// de textura van de centro a centro de esos texels, así que el filtrado
+// lineal nunca mezcla celdas vecinas.
+void init_glow_atlas() {
+    float half = (GLOW_ATLAS_CELL - 1) * 0.5f;
+    for (int t = 0; t < 4; t++) {
+        float radius = 0.0f, peak = 0.0f;
+        for (int k = 0; k < glow_layers_by_type[t]; k++) {
+            if (glow_layer_radius[t][k] > radius) radius = glow_layer_radius[t][k];
+            peak += glow_layer_alpha[t][k];
+        }
+        glow_sprite_radius[t] = radius;
+        glow_sprite_alpha[t] = peak;
+        glow_sprite_u0[t] = (t * GLOW_ATLAS_CELL + 0.5f) / GLOW_ATLAS_WIDTH;
+        glow_sprite_u1[t] = ((t + 1) * GLOW_ATLAS_CELL - 0.5f) / GLOW_ATLAS_WIDTH;
+        
+        for (int j = 0; j < GLOW_ATLAS_CELL; j++) {
+            for (int i = 0; i < GLOW_ATLAS_CELL; i++) {
+                float dx = (i - half) / half, dy = (j - half) / half;
+                float dist = sqrtf(dx * dx + dy * dy) * radius;  // En unidades de size
+                float a = 0.0f;
+                for (int k = 0; k < glow_layers_by_type[t]; k++) {
+                    if (dist < glow_layer_radius[t][k]) {
+                        a += glow_layer_alpha[t][k] * (1.0f - dist / glow_layer_radius[t][k]);
+                    }
+                }
+                glow_atlas[j][t * GLOW_ATLAS_CELL + i] = (unsigned char)(a / peak * 255.0f + 0.5f);
+            }
+        }
+    }
+    glow_sprite_v0 = 0.5f / GLOW_ATLAS_CELL;
+    glow_sprite_v1 = (GLOW_ATLAS_CELL - 0.5f) / GLOW_ATLAS_CELL;
+}
+
+RenderBatch render_batch;
+
+// Conteos por tipo y cursores de inicio de cada thread (generación paralela)
+int* thread_type_counts = NULL;
+BatchCursor* thread_cursors = NULL;
+int thread_slots = 0;
+
+// Garantiza capacidad para el frame actual (crece por duplicación)
+int reserve_vertex_buffer(VertexBuffer* buf, int vertices) {
+    if (vertices > buf->vertex_capacity) {
+        int new_capacity = buf->vertex_capacity > 0 ? buf->vertex_capacity : 1024;
+        while (new_capacity < vertices) new_capacity *= 2;
+        Vertex* new_vertices = (Vertex*)realloc(buf->vertices, (size_t)new_capacity * sizeof(Vertex));
+        if (!new_vertices) return 0;
+        buf->vertices = new_vertices;
+        buf->vertex_capacity = new_capacity;
+    }
+    buf->vertex_count = vertices;
+    return 1;
+}
+
+int reserve_sprite_buffer(SpriteBuffer* buf, int vertices) {
+    if (vertices > buf->vertex_capacity) {
+        int new_capacity = buf->vertex_capacity > 0 ? buf->vertex_capacity : 1024;
+        while (new_capacity < vertices) new_capacity *= 2;
+        SpriteVertex* new_vertices = (SpriteVertex*)realloc(buf->vertices, (size_t)new_capacity * sizeof(SpriteVertex));
+        if (!new_vertices) return 0;
+        buf->vertices = new_vertices;
+        buf->vertex_capacity = new_capacity;
     }
-    glEnd();
+    buf->vertex_count = vertices;
+    return 1;
 }
 
-void render_star(Star* star) {
-    float current_brightness = star->brightness * (0.7f + 0.3f * sin(star->pulse_phase));
+void free_render_batch(RenderBatch* batch) {
+    free(thread_type_counts);
+    free(thread_cursors);
+    thread_type_counts = NULL;
+    thread_cursors = NULL;
+    thread_slots = 0;
+    free(batch->glow.vertices);
+    free(batch->lines.vertices);
+    for (int k = 0; k < 3; k++) free(batch->points[k].vertices);
+    memset(batch, 0, sizeof(RenderBatch));
+}
+
+// Avanza el cursor lo que ocupa la geometría de type_counts estrellas
+void advance_batch_cursor(BatchCursor* cursor, const int type_counts[4]) {
+    for (int t = 0; t < 4; t++) {
+        cursor->glow += type_counts[t] * GLOW_QUAD_VERTICES;
+        cursor->line += type_counts[t] * line_vertices_by_type[t];
+        if (t < 3) cursor->point[t] += type_counts[t];
+    }
+}
+
+// Dimensiona el lote a partir de cuántas estrellas hay de cada tipo
+int prepare_render_batch(RenderBatch* batch, const int type_counts[4]) {
+    BatchCursor total = { 0 };
+    advance_batch_cursor(&total, type_counts);
+    
+    if (!reserve_sprite_buffer(&batch->glow, total.glow)) return 0;
+    if (!reserve_vertex_buffer(&batch->lines, total.line)) return 0;
+    for (int k = 0; k < 3; k++) {
+        if (!reserve_vertex_buffer(&batch->points[k], total.point[k])) return 0;
+    }
+    return 1;
+}
+
+int reserve_thread_slots(int threads) {
+    if (threads <= thread_slots) return 1;
+    int* new_counts = (int*)realloc(thread_type_counts, (size_t)threads * 4 * sizeof(int));
+    if (!new_counts) return 0;
+    thread_type_counts = new_counts;
+    BatchCursor* new_cursors = (BatchCursor*)realloc(thread_cursors, (size_t)threads * sizeof(BatchCursor));
+    if (!new_cursors) return 0;
+    thread_cursors = new_cursors;
+    thread_slots = threads;
+    return 1;
+}
+
+static inline void set_vertex(Vertex* v, float x, float y, float r, float g, float b, float a) {
+    v->x = x;
+    v->y = y;
+    v->r = r;
+    v->g = g;
+    v->b = b;
+    v->a = a;
+}
+
+static inline void emit_line(BatchCursor* cursor, float x0, float y0, float x1, float y1,
+                             float r, float g, float b) {
+    Vertex* v = &render_batch.lines.vertices[cursor->line];
+    set_vertex(&v[0], x0, y0, r, g, b, 1.0f);
+    set_vertex(&v[1], x1, y1, r, g, b, 1.0f);
+    cursor->line += 2;
+}
+
+static inline void emit_point(BatchCursor* cursor, int bucket, float x, float y, float r, float g, float b) {
+    set_vertex(&render_batch.points[bucket].vertices[cursor->point[bucket]++], x, y, r, g, b, 1.0f);
+}
+
+static inline void set_sprite_vertex(SpriteVertex* v, float x, float y, float u, float tv,
+                                     float r, float g, float b, float a) {
+    v->x = x;
+    v->y = y;
+    v->u = u;
+    v->v = tv;
+    v->r = r;
+    v->g = g;
+    v->b = b;
+    v->a = a;
+}
+
+// Función para dibujar estrella con efecto de brillo: un quad con la celda
+// del atlas de su tipo, que ya trae todas sus capas (centro opaco, borde
+// transparente). El alpha del vértice escala el perfil con GL_MODULATE.
+void draw_star_glow(BatchCursor* cursor, int type, float x, float y, float size,
+                    float r, float g, float b, float intensity) {
+    SpriteVertex* v = &render_batch.glow.vertices[cursor->glow];
+    float radius = size * glow_sprite_radius[type];
+    float alpha = intensity * glow_sprite_alpha[type];
+    float u0 = glow_sprite_u0[type], u1 = glow_sprite_u1[type];
+    
+    set_sprite_vertex(&v[0], x - radius, y - radius, u0, glow_sprite_v0, r, g, b, alpha);
+    set_sprite_vertex(&v[1], x + radius, y - radius, u1, glow_sprite_v0, r, g, b, alpha);
+    set_sprite_vertex(&v[2], x + radius, y + radius, u1, glow_sprite_v1, r, g, b, alpha);
+    set_sprite_vertex(&v[3], x - radius, y + radius, u0, glow_sprite_v1, r, g, b, alpha);
+    cursor->glow += GLOW_QUAD_VERTICES;
+}
+
+// Función para generar la geometría de los diferentes tipos de estrellas
+void render_star(Star* star, BatchCursor* cursor) {
+    // Un solo par seno/coseno de la fase por estrella; el resto sale de tablas
+    float phase_sin = sinf(star->pulse_phase);
+    float phase_cos = cosf(star->pulse_phase);
+    float current_brightness = star->brightness * (0.7f + 0.3f * phase_sin);
     float r = star->r * current_brightness;
     float g = star->g * current_brightness;
     float b = star->b * current_brightness;
-    float x = star->x;
-    float y = star->y;
+    
+    float x = star->prev_x + (star->x - star->prev_x) * render_alpha;
+    float y = star->prev_y + (star->y - star->prev_y) * render_alpha;
     float size = star->size;
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    
     switch(star->star_type) {
-        case 0:
-            draw_star_glow(x, y, size * 3, r, g, b, 0.1f * star->glow_intensity);
-            draw_star_glow(x, y, size * 2, r, g, b, 0.2f * star->glow_intensity);
-            glColor3f(r, g, b);
-            glBegin(GL_LINES);
-            glVertex2f(x - size, y); glVertex2f(x + size, y);
-            glVertex2f(x, y - size); glVertex2f(x, y + size);
-            glEnd();
-            glPointSize(3.0f);
-            glBegin(GL_POINTS);
-            glColor3f(r * 1.2f, g * 1.2f, b * 1.2f);
-            glVertex2f(x, y);
-            glEnd();
+        case 0: // Estrella cruz simple con brillo
+            // Efecto de brillo externo (dos capas en el atlas)
+            draw_star_glow(cursor, 0, x, y, size, r, g, b, star->glow_intensity);
+            
+            // Cruz principal
+            emit_line(cursor, x - size, y, x + size, y, r, g, b);
+            emit_line(cursor, x, y - size, x, y + size, r, g, b);
+            
+            // Centro brillante
+            emit_point(cursor, 0, x, y, r * 1.2f, g * 1.2f, b * 1.2f);
             break;
-        case 1:
-            draw_star_glow(x, y, size * 4, r, g, b, 0.15f * star->glow_intensity);
-            glColor3f(r, g, b);
-            glBegin(GL_LINES);
-            glVertex2f(x - size, y); glVertex2f(x + size, y);
-            glVertex2f(x, y - size); glVertex2f(x, y + size);
+            
+        case 1: // Estrella de 6 puntas
+            // Efecto de brillo
+            draw_star_glow(cursor, 1, x, y, size, r, g, b, star->glow_intensity);
+            
+            // Cruz principal
+            emit_line(cursor, x - size, y, x + size, y, r, g, b);
+            emit_line(cursor, x, y - size, x, y + size, r, g, b);
+            // Diagonales
             float diag = size * 0.7f;
-            glVertex2f(x - diag, y - diag); glVertex2f(x + diag, y + diag);
-            glVertex2f(x - diag, y + diag); glVertex2f(x + diag, y - diag);
-            glEnd();
-            glPointSize(4.0f);
-            glBegin(GL_POINTS);
-            glColor3f(1.0f, 1.0f, 1.0f);
-            glVertex2f(x, y);
-            glEnd();
+            emit_line(cursor, x - diag, y - diag, x + diag, y + diag, r, g, b);
+            emit_line(cursor, x - diag, y + diag, x + diag, y - diag, r, g, b);
+            
+            // Centro
+            emit_point(cursor, 1, x, y, 1.0f, 1.0f, 1.0f);
             break;
-        case 2:
-            draw_star_glow(x, y, size * 5, r, g, b, 0.08f * star->glow_intensity);
-            draw_star_glow(x, y, size * 3, r, g, b, 0.15f * star->glow_intensity);
-            draw_star_glow(x, y, size * 1.5f, r, g, b, 0.3f * star->glow_intensity);
-            glColor3f(r, g, b);
-            glBegin(GL_LINES);
-            for (int i = 0; i < 8; i++) {
-                float angle = (PI * 2 * i) / 8;
-                float ray_length = size * (1.2f + 0.3f * sin(star->pulse_phase + i));
-                glVertex2f(x, y);
-                glVertex2f(x + cos(angle) * ray_length, y + sin(angle) * ray_length);
+            
+        case 2: // Círculo brillante con rayos
+            // Múltiples capas de brillo (tres en el atlas)
+            draw_star_glow(cursor, 2, x, y, size, r, g, b, star->glow_intensity);
+            
+            // Rayos
+            for (int i = 0; i < RAY_COUNT; i++) {
+                // sin(fase + i) = sin(fase)cos(i) + cos(fase)sin(i)
+                float ray_wave = phase_sin * ray_phase_cos[i] + phase_cos * ray_phase_sin[i];
+                float ray_length = size * (1.2f + 0.3f * ray_wave);
+                emit_line(cursor, x, y, x + ray_cos[i] * ray_length, y + ray_sin[i] * ray_length, r, g, b);
             }
-            glEnd();
-            glPointSize(5.0f);
-            glBegin(GL_POINTS);
-            glColor3f(1.0f, 1.0f, 1.0f);
-            glVertex2f(x, y);
-            glEnd();
+            
+            // Centro súper brillante
+            emit_point(cursor, 2, x, y, 1.0f, 1.0f, 1.0f);
             break;
-        case 3:
-            float pulse_factor = 1.0f + 0.5f * sin(star->pulse_phase * 2);
-            draw_star_glow(x, y, size * 6 * pulse_factor, r, g, b, 0.05f * star->glow_intensity);
-            draw_star_glow(x, y, size * 3 * pulse_factor, r, g, b, 0.1f * star->glow_intensity);
-            glColor3f(r, g, b);
-            glBegin(GL_LINE_LOOP);
-            for (int i = 0; i < 10; i++) {
-                float angle = (PI * 2 * i) / 10;
+            
+        case 3: // Estrella pulsante compleja
+            // Brillo variable con múltiples capas
+            float pulse_factor = 1.0f + 0.5f * (2.0f * phase_sin * phase_cos); // sin(2 * fase)
+            draw_star_glow(cursor, 3, x, y, size * pulse_factor, r, g, b, star->glow_intensity);
+            
+            // Forma de estrella más compleja (contorno cerrado de 10 vértices)
+            float prev_x = 0.0f, prev_y = 0.0f, first_x = 0.0f, first_y = 0.0f;
+            for (int i = 0; i < SHAPE_POINTS; i++) {
                 float radius = (i % 2 == 0) ? size : size * 0.5f;
                 radius *= pulse_factor;
-                glVertex2f(x + cos(angle) * radius, y + sin(angle) * radius);
+                float px = x + shape_cos[i] * radius;
+                float py = y + shape_sin[i] * radius;
+                if (i == 0) {
+                    first_x = px;
+                    first_y = py;
+                } else {
+                    emit_line(cursor, prev_x, prev_y, px, py, r, g, b);
+                }
+                prev_x = px;
+                prev_y = py;
             }
-            glEnd();
+            emit_line(cursor, prev_x, prev_y, first_x, first_y, r, g, b);
             break;
     }
+}
+
+// Envía un buffer con un solo draw call usando arreglos de vértices
+void submit_vertex_buffer(VertexBuffer* buf, GLenum mode) {
+    if (buf->vertex_count == 0) return;
+    glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &buf->vertices[0].x);
+    glColorPointer(4, GL_FLOAT, sizeof(Vertex), &buf->vertices[0].r);
+    glDrawArrays(mode, 0, buf->vertex_count);
+}
+
+// Sprites de brillo: quads texturizados con el atlas en un solo draw call
+void submit_sprite_buffer(SpriteBuffer* buf) {
+    if (buf->vertex_count == 0) return;
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, glow_texture);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(SpriteVertex), &buf->vertices[0].x);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(SpriteVertex), &buf->vertices[0].u);
+    glColorPointer(4, GL_FLOAT, sizeof(SpriteVertex), &buf->vertices[0].r);
+    glDrawArrays(GL_QUADS, 0, buf->vertex_count);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisable(GL_TEXTURE_2D);
+}
+
+// Dibuja el lote completo: el estado de blending se fija una vez por frame
+void submit_render_batch(RenderBatch* batch) {
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    
+    submit_sprite_buffer(&batch->glow);
+    submit_vertex_buffer(&batch->lines, GL_LINES);
+    for (int k = 0; k < 3; k++) {
+        glPointSize(3.0f + k);
+        submit_vertex_buffer(&batch->points[k], GL_POINTS);
+    }
+    
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
     glDisable(GL_BLEND);
 }
 
 void display_fps() {
     fps_counter++;
-    clock_t current_time = clock();
-    if (current_time - fps_timer >= CLOCKS_PER_SEC) {
-        fps = (float)fps_counter / ((current_time - fps_timer) / (float)CLOCKS_PER_SEC);
+    // omp_get_wtime es tiempo de pared; clock() suma CPU de todos los threads
+    double current_time = omp_get_wtime();
+    if (current_time - fps_timer >= 1.0) {
+        fps = (float)(fps_counter / (current_time - fps_timer));
+        float steps_per_second = (float)((sim_steps - fps_steps) / (current_time - fps_timer));
         fps_counter = 0;
+        fps_steps = sim_steps;
         fps_timer = current_time;
         char title[256];
         snprintf(title, sizeof(title), "Screensaver OpenGL - Estrellas: %d | FPS: %.1f", num_stars, fps);
         glutSetWindowTitle(title);
-        printf("FPS: %.1f\n", fps);
+        printf("FPS: %.1f | Pasos/seg: %.1f\n", fps, steps_per_second);
         if (fps < 30) printf("⚠️  ADVERTENCIA: FPS por debajo de 30!\n");
     }
 }
 
-void display() {
-    glClearColor(0.02f, 0.01f, 0.05f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+// Física en paralelo
+void update_stars() {
+    double phase_start = omp_get_wtime();
+    use_schedule(&physics_schedule);
+    #pragma omp parallel
+    {
+        double t0 = omp_get_wtime();
+        #pragma omp for schedule(runtime) nowait
+        for (int i = 0; i < num_stars; i++) {
+            apply_physics(&stars[i]);
+        }
+        profile_thread_add(PHASE_PHYSICS, trace_segment(PHASE_PHYSICS, t0));
+    }
+    profile_end(PHASE_PHYSICS, phase_start);
+    sim_steps++;
+    record_frame(num_stars);
+}
 
-    // Primero física en paralelo
-    #pragma omp parallel for schedule(dynamic)
-    for (int i = 0; i < num_stars; i++) {
-        apply_physics(&stars[i]);
+// Avanza la simulación hasta 'now' en pasos fijos; si el render se atrasa
+// corre hasta MAX_SUBSTEPS pasos y descarta el resto del atraso
+int advance_simulation(double now) {
+    if (sim_last_time < 0.0) sim_last_time = now - SIM_DT;
+    sim_accumulator += now - sim_last_time;
+    sim_last_time = now;
+    int steps = 0;
+    while (sim_accumulator >= SIM_DT && steps < MAX_SUBSTEPS) {
+        update_stars();
+        sim_accumulator -= SIM_DT;
+        steps++;
     }
+    if (sim_accumulator >= SIM_DT) sim_accumulator = fmod(sim_accumulator, SIM_DT);
+    render_alpha = (float)(sim_accumulator / SIM_DT);
+    return steps;
+}
 
-    // Luego renderizado secuencial
-    for (int i = 0; i < num_stars; i++) {
-        render_star(&stars[i]);
+// Generación de vértices en paralelo: cada thread cuenta los tipos de su
+// bloque estático de estrellas, una suma prefija da el inicio de su porción
+// del lote y cada thread la llena sin sincronización. Solo el envío GL
+// queda en el thread principal.
+void render_stars() {
+    int n = num_stars;
+    int batch_ok = 1;
+    
+    if (!reserve_thread_slots(omp_get_max_threads())) return;
+    
+    double phase_start = omp_get_wtime();
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+        int begin = (int)((long long)n * tid / nthreads);
+        int end = (int)((long long)n * (tid + 1) / nthreads);
+        
+        double t0 = omp_get_wtime();
+        int* counts = &thread_type_counts[tid * 4];
+        counts[0] = counts[1] = counts[2] = counts[3] = 0;
+        for (int i = begin; i < end; i++) counts[stars[i].star_type]++;
+        double busy = trace_segment(PHASE_VERTICES, t0);
+        
+        #pragma omp barrier
+        #pragma omp single
+        {
+            int type_counts[4] = { 0, 0, 0, 0 };
+            BatchCursor cursor = { 0 };
+            for (int t = 0; t < nthreads; t++) {
+                thread_cursors[t] = cursor;
+                advance_batch_cursor(&cursor, &thread_type_counts[t * 4]);
+                for (int k = 0; k < 4; k++) type_counts[k] += thread_type_counts[t * 4 + k];
+            }
+            batch_ok = prepare_render_batch(&render_batch, type_counts);
+        }
+        
+        t0 = omp_get_wtime();
+        if (batch_ok) {
+            BatchCursor cursor = thread_cursors[tid];
+            for (int i = begin; i < end; i++) render_star(&stars[i], &cursor);
+        }
+        profile_thread_add(PHASE_VERTICES, busy + trace_segment(PHASE_VERTICES, t0));
     }
+    profile_end(PHASE_VERTICES, phase_start);
+    
+    if (!batch_ok) {
+        printf("Error: No se pudo asignar memoria para el lote de vértices\n");
+        return;
+    }
+    // Sin contexto GL no se envía nada: headless mide solo la generación de vértices
+    if (headless_mode) return;
+    phase_start = omp_get_wtime();
+    submit_render_batch(&render_batch);
+    profile_end(PHASE_SUBMIT, phase_start);
+}
+
+void display() {
+    double frame_start = omp_get_wtime();
+    glClearColor(0.02f, 0.01f, 0.05f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    advance_simulation(frame_start);
+    render_stars();
 
     display_fps();
+    double swap_start = omp_get_wtime();
     glutSwapBuffers();
+    profile_end(PHASE_SWAP, swap_start);
+    trace_event("frame", "frame", frame_start, omp_get_wtime());
 }
 
 void reshape(int width, int height) {
@@ -233,12 +1681,16 @@ void reshape(int width, int height) {
 void keyboard(unsigned char key, int x, int y) {
     switch(key) {
         case 27: case 'q': case 'Q':
+            if (profile_prefix) profile_dump(profile_prefix);
+            if (snapshot_save_path) save_snapshot(snapshot_save_path);
+            record_end();
+            trace_flush();
             if (stars) free(stars);
+            free_render_batch(&render_batch);
             glutDestroyWindow(window_id);
             exit(0);
         case '+':
-            if (num_stars < MAX_STARS - 50) {
-                stars = realloc(stars, (num_stars + 50) * sizeof(Star));
+            if (num_stars <= MAX_STARS - 50 && reserve_stars(num_stars + 50)) {
                 #pragma omp parallel for
                 for (int i = num_stars; i < num_stars + 50; i++)
                     init_star(&stars[i], i);
@@ -246,10 +1698,13 @@ void keyboard(unsigned char key, int x, int y) {
             }
             break;
         case '-':
-            if (num_stars > 50) {
-                num_stars -= 50;
-                stars = realloc(stars, num_stars * sizeof(Star));
-            }
+            if (num_stars > 50) num_stars -= 50;
+            break;
+        case 'p': case 'P':
+            profile_dump(profile_prefix ? profile_prefix : "perfil");
+            break;
+        case 's': case 'S':
+            save_snapshot(snapshot_save_path ? snapshot_save_path : "snapshot.stars");
             break;
     }
 }
@@ -267,44 +1722,156 @@ void init_opengl() {
     glEnable(GL_ALPHA_TEST);
     glAlphaFunc(GL_GREATER, 0.0f);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    
+    // Atlas de brillo: solo alpha, el color sale del vértice (GL_MODULATE)
+    glGenTextures(1, &glow_texture);
+    glBindTexture(GL_TEXTURE_2D, glow_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, GLOW_ATLAS_WIDTH, GLOW_ATLAS_CELL, 0,
+                 GL_ALPHA, GL_UNSIGNED_BYTE, glow_atlas);
+}
+
+// Benchmark sin ventana: física + render sin glutMainLoop ni timer de 16 ms.
+// Sin contexto GL no se envía el lote: el render mide solo la generación de vértices.
+void run_headless() {
+    double physics_time = 0.0, render_time = 0.0;
+    if (headless_frames == 0) return;  // Solo inicializar (p. ej. para --save)
+    printf("Benchmark headless: %d frames con %d estrellas...\n", headless_frames, num_stars);
+    double start_time = omp_get_wtime();
+    for (int frame = 0; frame < headless_frames; frame++) {
+        double t0 = omp_get_wtime();
+        for (int step = 0; step < headless_substeps; step++) update_stars();
+        double t1 = omp_get_wtime();
+        render_stars();
+        double t2 = omp_get_wtime();
+        physics_time += t1 - t0;
+        render_time += t2 - t1;
+    }
+    double total_time = omp_get_wtime() - start_time;
+    char sched[32];
+    printf("Frames: %d | Estrellas: %d | Threads: %d | Schedule física: %s\n", headless_frames, num_stars,
+           omp_get_max_threads(), schedule_label(&physics_schedule, sched, sizeof(sched)));
+    printf("Física:  %.6f s total | %.4f ms/frame\n", physics_time, physics_time * 1000.0 / headless_frames);
+    printf("Render:  %.6f s total | %.4f ms/frame\n", render_time, render_time * 1000.0 / headless_frames);
+    printf("Total:   %.6f s | %.1f frames/seg\n", total_time, headless_frames / total_time);
+    printf("Pasos:   %lld (dt = %.4f s) | %.1f pasos/seg | %.1f s simulados\n",
+           sim_steps, SIM_DT, sim_steps / total_time, sim_steps * SIM_DT);
 }
 
 int validate_input(int argc, char* argv[]) {
-    if (argc != 2) {
-        printf("Uso: %s <numero_de_estrellas>\n", argv[0]);
+    if (argc < 2) {
+        printf("Uso: %s <numero_de_estrellas> [--headless] [--frames N] [--seed S] [--substeps N] [--profile PREFIJO] [--trace ARCHIVO.json] [--sched-physics TIPO[,CHUNK]] [--load ARCHIVO] [--save ARCHIVO] [--record ARCHIVO] [--record-encoding raw|q16|delta] [--record-colors] [--compare GOLDEN] [--tolerance T]\n", argv[0]);
         return -1;
     }
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) headless_mode = 1;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            headless_frames = atoi(argv[++i]);
+            if (headless_frames < 0) {
+                printf("Error: --frames debe ser un entero no negativo\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) star_seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--substeps") == 0 && i + 1 < argc) {
+            headless_substeps = atoi(argv[++i]);
+            if (headless_substeps <= 0) {
+                printf("Error: --substeps debe ser un entero positivo\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) profile_prefix = argv[++i];
+        else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) snapshot_load_path = argv[++i];
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) record_path = argv[++i];
+        else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) compare_path = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) compare_tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "--record-colors") == 0) record_colors = 1;
+        else if (strcmp(argv[i], "--record-encoding") == 0 && i + 1 < argc) {
+            if (!parse_record_encoding(argv[++i])) {
+                printf("Error: Codificación inválida: %s (raw|q16|delta)\n", argv[i]);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) snapshot_save_path = argv[++i];
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) trace_begin(argv[++i]);
+        else if (strcmp(argv[i], "--sched-physics") == 0 && i + 1 < argc) {
+            if (!parse_schedule(argv[++i], &physics_schedule)) {
+                printf("Error: Schedule inválido: %s (static|dynamic|guided|auto[,chunk])\n", argv[i]);
+                return -1;
+            }
+        }
+        else {
+            printf("Error: Opción desconocida: %s\n", argv[i]);
+            return -1;
+        }
+    }
     int n = atoi(argv[1]);
     if (n <= 0 || n > MAX_STARS) return -1;
     return n;
 }
 
 int main(int argc, char* argv[]) {
+    star_seed = (uint64_t)time(NULL);
     num_stars = validate_input(argc, argv);
     if (num_stars == -1) return 1;
-    glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_ALPHA);
-    glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
-    glutInitWindowPosition(100, 100);
-    char title[256];
-    snprintf(title, sizeof(title), "Screensaver OpenGL - Estrellas: %d", num_stars);
-    window_id = glutCreateWindow(title);
-    srand((unsigned int)time(NULL));
-    stars = (Star*)malloc(num_stars * sizeof(Star));
-    if (!stars) return 1;
-
-    // Inicialización de estrellas en paralelo
-    #pragma omp parallel for
-    for (int i = 0; i < num_stars; i++) init_star(&stars[i], i);
+    init_trig_tables();
+    init_glow_atlas();
+    if (!headless_mode) {
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_ALPHA);
+        glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
+        glutInitWindowPosition(100, 100);
+        char title[256];
+        snprintf(title, sizeof(title), "Screensaver OpenGL - Estrellas: %d", num_stars);
+        window_id = glutCreateWindow(title);
+    }
+    if (snapshot_load_path) {
+        // Estado inicial desde un snapshot (su número de estrellas manda)
+        num_stars = load_snapshot(snapshot_load_path);
+        if (num_stars < 0) return 1;
+        printf("Snapshot %s cargado: %d estrellas, paso %lld\n", snapshot_load_path, num_stars, sim_steps);
+    } else {
+        if (!reserve_stars(num_stars)) return 1;
+
+        // Inicialización de estrellas en paralelo (flujo aleatorio por estrella)
+        printf("Semilla: %llu\n", (unsigned long long)star_seed);
+        #pragma omp parallel for
+        for (int i = 0; i < num_stars; i++) init_star(&stars[i], i);
+    }
+
+    if (record_path) {
+        if (!record_begin(record_path)) return 1;
+        record_frame(num_stars);  // El estado inicial es el primer frame
+    }
+
+    if (headless_mode) {
+        run_headless();
+        if (profile_prefix) profile_dump(profile_prefix);
+        if (snapshot_save_path) save_snapshot(snapshot_save_path);
+        record_end();
+        trace_flush();
+        int regression_ok = compare_path ? compare_snapshot(compare_path) : 1;
+        free(stars);
+        free_render_batch(&render_batch);
+        return regression_ok ? 0 : 2;
+    }
 
     init_opengl();
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     glutKeyboardFunc(keyboard);
     glutTimerFunc(0, timer, 0);
-    fps_timer = clock();
+    fps_timer = omp_get_wtime();
     glutMainLoop();
 
+    record_end();
+    trace_flush();
     if (stars) free(stars);
+    free_render_batch(&render_batch);
     return 0;
 }
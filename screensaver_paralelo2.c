@@ -1,16 +1,34 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // mremap, sched_getcpu
+#include <sys/mman.h>
+#include <sched.h>
+#endif
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#ifdef _WIN32
 #include <windows.h>
+#include <malloc.h>
+#endif
 #include <GL/gl.h>
 #include <GL/glu.h>
 #include <GL/glut.h>
-#include <malloc.h>
+#include <GL/freeglut_ext.h>  // glutGetProcAddress (render instanciado)
+#include <GL/glext.h>
 #include <stdint.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <time.h>
 #include <string.h>
 #include <omp.h>
+#if defined(__x86_64__) || defined(__i386__)
 #include <immintrin.h>
+#endif
 
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
@@ -18,10 +36,12 @@
 #define MIN_CANVAS_HEIGHT 480
 #define FPS_TARGET 60
 #define PI 3.14159265359
-#define MAX_STARS 2000
+#define MAX_STARS 16777216  // Límite de cordura; las columnas crecen por duplicación
 #define GRID_SIZE 64  // Tamaño de cada celda del grid espacial
 #define CACHE_LINE_SIZE 64
 #define SIMD_WIDTH 8  
+#define STAR_COLUMNS 16  // Columnas del SoA (todas de 4 bytes por estrella)
+#define COLUMN_ALIGN_STARS (CACHE_LINE_SIZE / 4)  // Capacidad múltiplo de esto: columnas alineadas
 
 // Variables globales para medición de rendimiento
 double frame_time = 0.0;
@@ -35,6 +55,10 @@ typedef struct {
     float* __restrict__ vx;
     float* __restrict__ vy;
     
+    // Posiciones al inicio del último paso de física (para interpolar el render)
+    float* __restrict__ prev_x;
+    float* __restrict__ prev_y;
+    
     // Propiedades visuales
     float* __restrict__ brightness;
     float* __restrict__ pulse_phase;
@@ -52,19 +76,24 @@ typedef struct {
     // Grid espacial para optimización de colisiones
     int* __restrict__ grid_cell;
     
+    // Arena única que contiene todas las columnas, una tras otra, cada una
+    // de 'capacity' elementos y alineada a línea de caché
+    void* arena;
+    size_t arena_bytes;
+    int arena_mapped;  // La arena es el mapeo privado de un snapshot (--load)
+    
     int count;
     int capacity;
 } StarSystem;
 
-// Grid espacial para optimizar interacciones
-typedef struct {
-    int* star_indices;
-    int count;
-    int capacity;
-} GridCell;
-
+// Grid espacial para optimizar interacciones, en formato compacto (CSR):
+// las estrellas de la celda c son star_indices[cell_start[c] .. cell_start[c + 1])
 typedef struct {
-    GridCell* cells;
+    int* cell_start;          // total_cells + 1 desplazamientos
+    int* star_indices;        // Una entrada por estrella, agrupadas por celda
+    int* thread_histograms;   // Histograma de celdas por thread (total_cells cada uno)
+    int indices_capacity;
+    int histogram_threads;
     int width;
     int height;
     int total_cells;
@@ -72,424 +101,3187 @@ typedef struct {
 
 StarSystem* star_system = NULL;
 SpatialGrid* spatial_grid = NULL;
+int use_hugepages = 0;  // --hugepages: madvise(MADV_HUGEPAGE) sobre la arena (Linux)
 int window_id;
 clock_t last_time;
 int frame_count = 0;
 float fps = 0.0f;
-clock_t fps_timer;
+double fps_timer;
 int fps_counter = 0;
 
-// Forward declarations
-void destroy_star_system(StarSystem* sys);
+// Modo benchmark sin ventana (--headless --frames N)
+int headless_mode = 0;
+int headless_frames = 1000;
+int headless_substeps = 1;  // Pasos de física por frame en headless (--substeps N)
 
-void* aligned_malloc(size_t size, size_t alignment) {
-    void* ptr = _aligned_malloc(size, alignment);
+// Reloj de simulación de paso fijo: la física avanza SIM_DT por paso sin
+// importar el ritmo de render; el acumulador guarda el tiempo de pared aún
+// no simulado y render_alpha interpola entre las dos últimas posiciones
+#define SIM_DT (1.0 / FPS_TARGET)
+#define MAX_SUBSTEPS 5  // Tope de pasos por frame: más allá se descarta el atraso
+double sim_accumulator = 0.0;
+double sim_last_time = -1.0;
+long long sim_steps = 0;
+long long fps_steps = 0;
+float render_alpha = 1.0f;
+
+// Reordenamiento espacial del SoA cada N frames (--reorder N, 0 = desactivado)
+int reorder_interval = 0;
+StarSystem* reorder_scratch = NULL;
+
+// Política de scheduling de un bucle, elegible en tiempo de ejecución
+// (--sched-KERNEL tipo[,chunk]); los bucles usan schedule(runtime)
+typedef struct {
+    omp_sched_t kind;
+    int chunk;  // 0 = chunk por defecto de la política
+} LoopSchedule;
+
+static const char* schedule_kind_name(omp_sched_t kind) {
+    switch (kind) {
+        case omp_sched_static: return "static";
+        case omp_sched_dynamic: return "dynamic";
+        case omp_sched_guided: return "guided";
+        default: return "auto";
+    }
+}
+
+// Acepta "static", "dynamic,64", "guided,8", "auto"
+int parse_schedule(const char* text, LoopSchedule* out) {
+    char kind[16];
+    int chunk = 0;
+    const char* comma = strchr(text, ',');
+    size_t len = comma ? (size_t)(comma - text) : strlen(text);
+    if (len == 0 || len >= sizeof(kind)) return 0;
+    memcpy(kind, text, len);
+    kind[len] = '\0';
+    if (comma) {
+        chunk = atoi(comma + 1);
+        if (chunk <= 0) return 0;
+    }
+    
+    if (strcmp(kind, "static") == 0) out->kind = omp_sched_static;
+    else if (strcmp(kind, "dynamic") == 0) out->kind = omp_sched_dynamic;
+    else if (strcmp(kind, "guided") == 0) out->kind = omp_sched_guided;
+    else if (strcmp(kind, "auto") == 0) out->kind = omp_sched_auto;
+    else return 0;
+    out->chunk = chunk;
+    return 1;
+}
+
+// Texto "tipo" o "tipo,chunk" para los reportes
+const char* schedule_label(const LoopSchedule* sched, char* buf, size_t size) {
+    if (sched->chunk > 0) snprintf(buf, size, "%s,%d", schedule_kind_name(sched->kind), sched->chunk);
+    else snprintf(buf, size, "%s", schedule_kind_name(sched->kind));
+    return buf;
+}
+
+// Fija la política que usará el próximo bucle schedule(runtime) de este thread
+static inline void use_schedule(const LoopSchedule* sched) {
+    omp_set_schedule(sched->kind, sched->chunk);
+}
+
+LoopSchedule physics_schedule = { omp_sched_guided, 0 };        // --sched-physics
+LoopSchedule interactions_schedule = { omp_sched_dynamic, 0 };  // --sched-interactions
+
+// Threads y afinidad: --threads N (o OMP_NUM_THREADS), --bind / --places
+// (equivalentes a OMP_PROC_BIND / OMP_PLACES). 'T' alterna entre 1 thread
+// y configured_threads.
+int requested_threads = 0;
+int configured_threads = 1;
+const char* requested_bind = NULL;
+const char* requested_places = NULL;
+
+// Autoprueba de los kernels SIMD contra el escalar (--selftest-simd)
+int simd_selftest = 0;
+
+// Pipeline física/render (--no-pipeline lo desactiva): el render dibuja el
+// frame N desde front_system mientras la simulación calcula el N+1 sobre
+// star_system. front_alpha es el render_alpha del estado publicado.
+int pipeline_enabled = 1;
+
+// Interacciones entre estrellas (--no-interactions las omite: queda solo la
+// física que comparten los tres builds, para la regresión cruzada)
+int interactions_enabled = 1;
+StarSystem* front_system = NULL;
+float front_alpha = 1.0f;
+int front_static_dirty = 1;  // Reorden o estrellas nuevas: copiar también las columnas fijas
+
+// Trazas de línea de tiempo en formato Chrome/Perfetto (--trace ARCHIVO.json).
+// Cada carril (fila de la línea de tiempo) tiene su buffer circular y lo
+// escribe un solo thread a la vez, así que registrar un evento no necesita
+// locks; al salir se vuelcan todos al JSON. Si un buffer se llena se
+// conservan los TRACE_RING_EVENTS más recientes.
+#define TRACE_RING_EVENTS 65536
+#define TRACE_TEAM_LANES 32  // Carriles por equipo de threads
+#define TRACE_MAX_LANES (TRACE_TEAM_LANES * (TRACE_TEAM_LANES + 1))
+
+typedef struct {
+    const char* name;
+    const char* category;
+    double start;
+    double end;
+} TraceEvent;
+
+typedef struct {
+    TraceEvent* events;
+    long long written;
+    int level;      // Nivel de anidamiento de OpenMP del carril
+    int outer_tid;  // Thread del equipo exterior (solo nivel 2)
+    int team_tid;   // omp_get_thread_num() dentro de su equipo
+} TraceRing;
+
+int trace_enabled = 0;
+const char* trace_path = NULL;
+double trace_origin = 0.0;
+TraceRing trace_rings[TRACE_MAX_LANES];
+
+// Carril del thread actual. Con equipos anidados omp_get_thread_num() se
+// repite entre equipos (y libgomp puede recrear esos threads), así que el
+// nivel 2 usa un bloque de carriles por cada thread del equipo exterior.
+static TraceRing* trace_ring() {
+    int level = omp_get_level();
+    int tid = omp_get_thread_num();
+    int outer = (level >= 2) ? omp_get_ancestor_thread_num(1) : -1;
+    if (tid >= TRACE_TEAM_LANES || outer >= TRACE_TEAM_LANES) return NULL;
+    
+    int lane = (level >= 2) ? (outer + 1) * TRACE_TEAM_LANES + tid : tid;
+    TraceRing* ring = &trace_rings[lane];
+    if (!ring->events) {
+        ring->events = (TraceEvent*)malloc(TRACE_RING_EVENTS * sizeof(TraceEvent));
+        ring->level = (level < 2) ? level : 2;
+        ring->outer_tid = outer;
+        ring->team_tid = tid;
+    }
+    return ring->events ? ring : NULL;
+}
+
+static inline void trace_event(const char* name, const char* category, double start, double end) {
+    if (!trace_enabled) return;
+    TraceRing* ring = trace_ring();
+    if (!ring) return;
+    TraceEvent* ev = &ring->events[ring->written % TRACE_RING_EVENTS];
+    ev->name = name;
+    ev->category = category;
+    ev->start = start;
+    ev->end = end;
+    ring->written++;
+}
+
+void trace_begin(const char* path) {
+    trace_path = path;
+    trace_origin = omp_get_wtime();
+    trace_enabled = 1;
+}
+
+// Escribe los eventos como "complete events" (ph X) con tiempos en microsegundos
+void trace_flush() {
+    if (!trace_enabled) return;
+    trace_enabled = 0;
+    
+    FILE* out = fopen(trace_path, "w");
+    if (!out) {
+        printf("Error: No se pudo escribir la traza en %s\n", trace_path);
+        return;
+    }
+    
+    int lanes = 0;
+    long long total = 0;
+    int first = 1;
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    for (int t = 0; t < TRACE_MAX_LANES; t++) {
+        TraceRing* ring = &trace_rings[t];
+        if (!ring->events) continue;
+        
+        char label[64];
+        if (ring->level < 2) snprintf(label, sizeof(label), "thread %d", ring->team_tid);
+        else snprintf(label, sizeof(label), "thread %d / equipo de %d", ring->team_tid, ring->outer_tid);
+        fprintf(out, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                "\"args\": {\"name\": \"%s\"}}, "
+                "{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                "\"args\": {\"sort_index\": %d}}",
+                first ? "" : ",", t, label, t, t);
+        first = 0;
+        lanes++;
+        
+        long long count = (ring->written < TRACE_RING_EVENTS) ? ring->written : TRACE_RING_EVENTS;
+        for (long long k = ring->written - count; k < ring->written; k++) {
+            const TraceEvent* ev = &ring->events[k % TRACE_RING_EVENTS];
+            fprintf(out, ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                    "\"ts\": %.3f, \"dur\": %.3f}",
+                    ev->name, ev->category, t,
+                    (ev->start - trace_origin) * 1e6, (ev->end - ev->start) * 1e6);
+        }
+        total += count;
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    
+    for (int t = 0; t < TRACE_MAX_LANES; t++) {
+        free(trace_rings[t].events);
+        trace_rings[t].events = NULL;
+    }
+    printf("Traza guardada en %s (%lld eventos, %d carriles)\n", trace_path, total, lanes);
+}
+
+// Perfilado por fase: cada fase guarda su duración en una ventana rodante
+// de PROFILE_WINDOW muestras, de la que salen min/prom/p50/p99/max.
+// phase_wall es el tiempo de pared de la fase (una muestra por ejecución);
+// phase_thread el trabajo de cada thread dentro de la región paralela,
+// sin contar esperas en barreras, para ver el desbalance de carga.
+enum {
+    PHASE_GRID,
+    PHASE_PHYSICS,
+    PHASE_INTERACTIONS,
+    PHASE_VERTICES,
+    PHASE_SUBMIT,
+    PHASE_RASTER,
+    PHASE_SWAP,
+    PHASE_COUNT
+};
+static const char* phase_names[PHASE_COUNT] = {
+    "grid", "fisica", "interacciones", "vertices", "envio_gl", "raster", "swap"
+};
+
+#define PROFILE_WINDOW 512
+#define PROFILE_MAX_THREADS 64
+
+typedef struct {
+    float samples[PROFILE_WINDOW];  // Milisegundos, buffer circular
+    int next;
+    int filled;
+} PhaseSamples;
+
+typedef struct {
+    int samples;
+    float min, avg, p50, p99, max;
+} PhaseSummary;
+
+PhaseSamples phase_wall[PHASE_COUNT];
+PhaseSamples phase_thread[PHASE_COUNT][PROFILE_MAX_THREADS];
+const char* profile_prefix = NULL;  // --profile PREFIJO: volcar CSV/JSON al salir
+
+static inline void profile_add(PhaseSamples* ps, double seconds) {
+    ps->samples[ps->next] = (float)(seconds * 1000.0);
+    ps->next = (ps->next + 1) % PROFILE_WINDOW;
+    if (ps->filled < PROFILE_WINDOW) ps->filled++;
+}
+
+// Cierra el temporizador de una fase abierto con start = omp_get_wtime()
+static inline void profile_end(int phase, double start) {
+    double end = omp_get_wtime();
+    profile_add(&phase_wall[phase], end - start);
+    trace_event(phase_names[phase], "fase", start, end);
+}
+
+// Trabajo propio del thread que llama dentro de la fase
+static inline void profile_thread_add(int phase, double seconds) {
+    int tid = omp_get_thread_num();
+    if (tid < PROFILE_MAX_THREADS) profile_add(&phase_thread[phase][tid], seconds);
+}
+
+// Cierra un tramo de trabajo del thread dentro de la fase: lo traza y
+// devuelve su duración para el perfil
+static inline double trace_segment(int phase, double start) {
+    double end = omp_get_wtime();
+    trace_event(phase_names[phase], "bucle", start, end);
+    return end - start;
+}
+
+static int compare_floats(const void* a, const void* b) {
+    float fa = *(const float*)a;
+    float fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+static int summarize_phase(const PhaseSamples* ps, PhaseSummary* out) {
+    static float sorted[PROFILE_WINDOW];
+    int n = ps->filled;
+    if (n == 0) return 0;
+    
+    memcpy(sorted, ps->samples, n * sizeof(float));
+    qsort(sorted, n, sizeof(float), compare_floats);
+    
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += sorted[i];
+    
+    out->samples = n;
+    out->min = sorted[0];
+    out->avg = (float)(sum / n);
+    out->p50 = sorted[(n - 1) / 2];
+    out->p99 = sorted[(int)ceil(0.99 * n) - 1];
+    out->max = sorted[n - 1];
+    return 1;
+}
+
+// Vuelca las estadísticas a <prefijo>.csv y <prefijo>.json y las muestra
+void profile_dump(const char* prefix) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s.csv", prefix);
+    FILE* csv = fopen(path, "w");
+    snprintf(path, sizeof(path), "%s.json", prefix);
+    FILE* json = fopen(path, "w");
+    if (!csv || !json) {
+        printf("Error: No se pudo escribir el perfil en %s.csv / %s.json\n", prefix, prefix);
+        if (csv) fclose(csv);
+        if (json) fclose(json);
+        return;
+    }
+    
+    fprintf(csv, "fase,thread,muestras,min_ms,prom_ms,p50_ms,p99_ms,max_ms\n");
+    fprintf(json, "{\n  \"build\": \"paralelo2\",\n  \"ventana\": %d,\n  \"fases\": [", PROFILE_WINDOW);
+    printf("\n=== PERFIL POR FASE (últimas %d muestras, ms) ===\n", PROFILE_WINDOW);
+    printf("%-14s %-7s %8s %9s %9s %9s %9s %9s\n", "Fase", "Thread", "Muestras", "Min", "Prom", "P50", "P99", "Max");
     
-    // Fallback si falla _aligned_malloc
-    if (!ptr) {
-        ptr = malloc(size + alignment - 1);
-        if (ptr) {
-            uintptr_t addr = (uintptr_t)ptr;
-            uintptr_t aligned_addr = (addr + alignment - 1) & ~(alignment - 1);
-            return (void*)aligned_addr;
+    int first = 1;
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        for (int slot = -1; slot < PROFILE_MAX_THREADS; slot++) {
+            const PhaseSamples* ps = (slot < 0) ? &phase_wall[phase] : &phase_thread[phase][slot];
+            PhaseSummary st;
+            if (!summarize_phase(ps, &st)) continue;
+            
+            char thread_label[16];
+            if (slot < 0) snprintf(thread_label, sizeof(thread_label), "todos");
+            else snprintf(thread_label, sizeof(thread_label), "%d", slot);
+            
+            fprintf(csv, "%s,%s,%d,%.4f,%.4f,%.4f,%.4f,%.4f\n", phase_names[phase], thread_label,
+                    st.samples, st.min, st.avg, st.p50, st.p99, st.max);
+            fprintf(json, "%s\n    {\"fase\": \"%s\", \"thread\": \"%s\", \"muestras\": %d, "
+                    "\"min_ms\": %.4f, \"prom_ms\": %.4f, \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f}",
+                    first ? "" : ",", phase_names[phase], thread_label, st.samples,
+                    st.min, st.avg, st.p50, st.p99, st.max);
+            printf("%-14s %-7s %8d %9.4f %9.4f %9.4f %9.4f %9.4f\n", phase_names[phase], thread_label,
+                   st.samples, st.min, st.avg, st.p50, st.p99, st.max);
+            first = 0;
         }
     }
     
+    fprintf(json, "\n  ]\n}\n");
+    fclose(csv);
+    fclose(json);
+    printf("Perfil guardado en %s.csv y %s.json\n", prefix, prefix);
+}
+
+// Forward declarations
+void destroy_star_system(StarSystem* sys);
+
+// Reserva alineada portable: _aligned_malloc en Windows, posix_memalign en
+// Linux/POSIX. Ambas devuelven NULL si falla y se liberan con aligned_free.
+void* aligned_malloc(size_t size, size_t alignment) {
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, alignment, size) != 0) return NULL;
     return ptr;
+#endif
 }
 
 void aligned_free(void* ptr) {
+#ifdef _WIN32
     _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+// Memoria de la arena: en Linux se usa mmap para poder crecer con mremap
+// (el kernel mueve las páginas sin copiarlas) y pedir páginas grandes;
+// en otros sistemas, memoria alineada y realloc/copia.
+static void* arena_alloc(size_t bytes) {
+#ifdef __linux__
+    void* arena = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (arena == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+    if (use_hugepages) madvise(arena, bytes, MADV_HUGEPAGE);
+#endif
+    return arena;
+#else
+    return aligned_malloc(bytes, CACHE_LINE_SIZE);
+#endif
+}
+
+// Agranda la arena conservando su contenido (los primeros old_bytes)
+static void* arena_grow(void* arena, size_t old_bytes, size_t new_bytes) {
+#ifdef __linux__
+    void* grown = mremap(arena, old_bytes, new_bytes, MREMAP_MAYMOVE);
+    if (grown == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+    if (use_hugepages) madvise(grown, new_bytes, MADV_HUGEPAGE);
+#endif
+    return grown;
+#elif defined(_WIN32)
+    (void)old_bytes;
+    return _aligned_realloc(arena, new_bytes, CACHE_LINE_SIZE);
+#else
+    void* grown = aligned_malloc(new_bytes, CACHE_LINE_SIZE);
+    if (!grown) return NULL;
+    memcpy(grown, arena, old_bytes);
+    aligned_free(arena);
+    return grown;
+#endif
+}
+
+static void arena_free(void* arena, size_t bytes) {
+    if (!arena) return;
+#ifdef __linux__
+    munmap(arena, bytes);
+#else
+    (void)bytes;
+    aligned_free(arena);
+#endif
+}
+
+// Direcciones de los punteros de columna, en el orden en que viven en la arena
+static void star_system_columns(StarSystem* sys, void** columns[STAR_COLUMNS]) {
+    columns[0] = (void**)&sys->x;
+    columns[1] = (void**)&sys->y;
+    columns[2] = (void**)&sys->vx;
+    columns[3] = (void**)&sys->vy;
+    columns[4] = (void**)&sys->brightness;
+    columns[5] = (void**)&sys->pulse_phase;
+    columns[6] = (void**)&sys->pulse_speed;
+    columns[7] = (void**)&sys->size;
+    columns[8] = (void**)&sys->r;
+    columns[9] = (void**)&sys->g;
+    columns[10] = (void**)&sys->b;
+    columns[11] = (void**)&sys->glow_intensity;
+    columns[12] = (void**)&sys->star_type;
+    columns[13] = (void**)&sys->grid_cell;
+    columns[14] = (void**)&sys->prev_x;
+    columns[15] = (void**)&sys->prev_y;
 }
 
-// Inicialización del sistema de estrellas
+static void assign_star_columns(StarSystem* sys) {
+    void** columns[STAR_COLUMNS];
+    star_system_columns(sys, columns);
+    size_t stride = (size_t)sys->capacity * 4;
+    for (int k = 0; k < STAR_COLUMNS; k++) {
+        *columns[k] = (char*)sys->arena + k * stride;
+    }
+}
+
+static int round_capacity(int count) {
+    if (count < COLUMN_ALIGN_STARS) count = COLUMN_ALIGN_STARS;
+    return count + (COLUMN_ALIGN_STARS - (count % COLUMN_ALIGN_STARS)) % COLUMN_ALIGN_STARS;
+}
+
+// Inicialización del sistema de estrellas: una sola reserva para todas las columnas
 StarSystem* create_star_system(int count) {
-    StarSystem* sys = (StarSystem*)malloc(sizeof(StarSystem));
+    StarSystem* sys = (StarSystem*)calloc(1, sizeof(StarSystem));
     if (!sys) return NULL;
     
     sys->count = count;
-    sys->capacity = count + (SIMD_WIDTH - (count % SIMD_WIDTH)) % SIMD_WIDTH; // Align 
-    size_t aligned_size = sys->capacity * sizeof(float);
-    
-    sys->x = (float*)aligned_malloc(aligned_size, CACHE_LINE_SIZE);
-    sys->y = (float*)aligned_malloc(aligned_size, CACHE_LINE_SIZE);
-    sys->vx = (float*)aligned_malloc(aligned_size, CACHE_LINE_SIZE);
-    sys->vy = (float*)aligned_malloc(aligned_size, CACHE_LINE_SIZE);
-    sys->brightness = (float*)aligned_malloc(aligned_size, CACHE_LINE_SIZE);
-    sys->pulse_phase = (float*)aligned_malloc(aligned_size, CACHE_LINE_SIZE);
-    sys->pulse_speed = (float*)aligned_malloc(aligned_size, CACHE_LINE_SIZE);
-    sys->size = (float*)aligned_malloc(aligned_size, CACHE_LINE_SIZE);
-    sys->r = (float*)aligned_malloc(aligned_size, CACHE_LINE_SIZE);
-    sys->g = (float*)aligned_malloc(aligned_size, CACHE_LINE_SIZE);
-    sys->b = (float*)aligned_malloc(aligned_size, CACHE_LINE_SIZE);
-    sys->glow_intensity = (float*)aligned_malloc(aligned_size, CACHE_LINE_SIZE);
-    
-    sys->star_type = (int*)aligned_malloc(sys->capacity * sizeof(int), CACHE_LINE_SIZE);
-    sys->grid_cell = (int*)aligned_malloc(sys->capacity * sizeof(int), CACHE_LINE_SIZE);
-    if (!sys->x || !sys->y || !sys->vx || !sys->vy || !sys->brightness || 
-        !sys->pulse_phase || !sys->pulse_speed || !sys->size || 
-        !sys->r || !sys->g || !sys->b || !sys->glow_intensity || 
-        !sys->star_type || !sys->grid_cell) {
-        destroy_star_system(sys);
+    sys->capacity = round_capacity(count);
+    sys->arena_bytes = (size_t)sys->capacity * 4 * STAR_COLUMNS;
+    sys->arena = arena_alloc(sys->arena_bytes);
+    if (!sys->arena) {
+        free(sys);
         return NULL;
     }
+    assign_star_columns(sys);
     
     return sys;
 }
 
+static void release_arena(StarSystem* sys) {
+#ifndef _WIN32
+    if (sys->arena_mapped) {
+        munmap(sys->arena, sys->arena_bytes);
+        return;
+    }
+#endif
+    arena_free(sys->arena, sys->arena_bytes);
+}
+
 void destroy_star_system(StarSystem* sys) {
     if (!sys) return;
     
-    aligned_free(sys->x);
-    aligned_free(sys->y);
-    aligned_free(sys->vx);
-    aligned_free(sys->vy);
-    aligned_free(sys->brightness);
-    aligned_free(sys->pulse_phase);
-    aligned_free(sys->pulse_speed);
-    aligned_free(sys->size);
-    aligned_free(sys->r);
-    aligned_free(sys->g);
-    aligned_free(sys->b);
-    aligned_free(sys->glow_intensity);
-    aligned_free(sys->star_type);
-    aligned_free(sys->grid_cell);
-    
+    release_arena(sys);
     free(sys);
 }
 
-SpatialGrid* create_spatial_grid() {
-    SpatialGrid* grid = (SpatialGrid*)malloc(sizeof(SpatialGrid));
-    grid->width = (WINDOW_WIDTH + GRID_SIZE - 1) / GRID_SIZE;
-    grid->height = (WINDOW_HEIGHT + GRID_SIZE - 1) / GRID_SIZE;
-    grid->total_cells = grid->width * grid->height;
+// Garantiza capacidad para 'needed' estrellas con crecimiento geométrico.
+// La arena crece en bloque (mremap en Linux) y luego cada columna se
+// reubica dentro de la misma arena, de la última a la primera para no
+// pisar datos que aún no se movieron.
+int reserve_star_system(StarSystem* sys, int needed) {
+    if (needed <= sys->capacity) return 1;
+    
+    int new_capacity = (sys->capacity > 0) ? sys->capacity : 64;
+    while (new_capacity < needed) {
+        new_capacity = (new_capacity > MAX_STARS / 2) ? MAX_STARS : new_capacity * 2;
+    }
+    new_capacity = round_capacity(new_capacity);
+    
+    size_t old_stride = (size_t)sys->capacity * 4;
+    size_t new_stride = (size_t)new_capacity * 4;
+    size_t new_bytes = new_stride * STAR_COLUMNS;
+    
+    void* arena;
+    if (sys->arena_mapped) {
+        // Un mapeo de archivo no crece más allá del archivo: pasar a memoria anónima
+        arena = arena_alloc(new_bytes);
+        if (!arena) return 0;
+        memcpy(arena, sys->arena, sys->arena_bytes);
+        release_arena(sys);
+        sys->arena_mapped = 0;
+    } else {
+        arena = arena_grow(sys->arena, sys->arena_bytes, new_bytes);
+        if (!arena) return 0;
+    }
+    
+    size_t live_bytes = (size_t)sys->count * 4;
+    for (int k = STAR_COLUMNS - 1; k > 0; k--) {
+        memmove((char*)arena + k * new_stride, (char*)arena + k * old_stride, live_bytes);
+    }
+    
+    sys->arena = arena;
+    sys->arena_bytes = new_bytes;
+    sys->capacity = new_capacity;
+    assign_star_columns(sys);
+    return 1;
+}
+
+SpatialGrid* create_spatial_grid() {
+    SpatialGrid* grid = (SpatialGrid*)calloc(1, sizeof(SpatialGrid));
+    if (!grid) return NULL;
+    grid->width = (WINDOW_WIDTH + GRID_SIZE - 1) / GRID_SIZE;
+    grid->height = (WINDOW_HEIGHT + GRID_SIZE - 1) / GRID_SIZE;
+    grid->total_cells = grid->width * grid->height;
+    
+    grid->cell_start = (int*)calloc(grid->total_cells + 1, sizeof(int));
+    if (!grid->cell_start) {
+        free(grid);
+        return NULL;
+    }
+    
+    return grid;
+}
+
+// Garantiza espacio para 'stars' índices y 'threads' histogramas (por duplicación)
+int reserve_spatial_grid(SpatialGrid* grid, int stars, int threads) {
+    if (stars > grid->indices_capacity) {
+        int new_capacity = grid->indices_capacity > 0 ? grid->indices_capacity : 1024;
+        while (new_capacity < stars) new_capacity *= 2;
+        int* new_indices = (int*)realloc(grid->star_indices, (size_t)new_capacity * sizeof(int));
+        if (!new_indices) return 0;
+        grid->star_indices = new_indices;
+        grid->indices_capacity = new_capacity;
+    }
+    
+    if (threads > grid->histogram_threads) {
+        int* new_histograms = (int*)realloc(grid->thread_histograms,
+                                            (size_t)threads * grid->total_cells * sizeof(int));
+        if (!new_histograms) return 0;
+        grid->thread_histograms = new_histograms;
+        grid->histogram_threads = threads;
+    }
+    
+    return 1;
+}
+
+void destroy_spatial_grid(SpatialGrid* grid) {
+    if (!grid) return;
+    
+    free(grid->cell_start);
+    free(grid->star_indices);
+    free(grid->thread_histograms);
+    free(grid);
+}
+
+// Generador pseudoaleatorio por estrella (SplitMix64): el flujo se deriva de
+// (semilla, índice de estrella), sin estado global compartido. Así la
+// inicialización escala con los threads y produce las mismas estrellas con
+// cualquier número de threads.
+typedef struct {
+    uint64_t state;
+} StarRng;
+
+uint64_t star_seed = 0;
+
+static inline uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline StarRng star_rng(int index) {
+    StarRng rng;
+    uint64_t key = star_seed ^ ((uint64_t)(uint32_t)index * 0xD1B54A32D192ED03ULL);
+    rng.state = splitmix64(&key);
+    return rng;
+}
+
+// Entero uniforme en [0, n)
+static inline int rng_range(StarRng* rng, int n) {
+    return (int)((splitmix64(&rng->state) >> 32) % (uint64_t)n);
+}
+
+void generate_star_color(int index, StarRng* rng) {
+    int color_type = rng_range(rng, 8);
+    switch(color_type) {
+        case 0: 
+            star_system->r[index] = 0.2f + rng_range(rng, 30) / 100.0f; 
+            star_system->g[index] = 0.4f + rng_range(rng, 40) / 100.0f; 
+            star_system->b[index] = 0.9f + rng_range(rng, 10) / 100.0f; 
+            break;
+        case 1: 
+            star_system->r[index] = 0.9f + rng_range(rng, 10) / 100.0f; 
+            star_system->g[index] = 0.2f + rng_range(rng, 30) / 100.0f; 
+            star_system->b[index] = 0.7f + rng_range(rng, 30) / 100.0f; 
+            break;
+        case 2: 
+            star_system->r[index] = 0.9f + rng_range(rng, 10) / 100.0f; 
+            star_system->g[index] = 0.8f + rng_range(rng, 20) / 100.0f; 
+            star_system->b[index] = 0.1f + rng_range(rng, 20) / 100.0f; 
+            break;
+        case 3: 
+            star_system->r[index] = 0.1f + rng_range(rng, 20) / 100.0f; 
+            star_system->g[index] = 0.8f + rng_range(rng, 20) / 100.0f; 
+            star_system->b[index] = 0.3f + rng_range(rng, 30) / 100.0f; 
+            break;
+        case 4: 
+            star_system->r[index] = 0.9f + rng_range(rng, 10) / 100.0f; 
+            star_system->g[index] = 0.5f + rng_range(rng, 30) / 100.0f; 
+            star_system->b[index] = 0.1f + rng_range(rng, 20) / 100.0f; 
+            break;
+        case 5: 
+            star_system->r[index] = 0.7f + rng_range(rng, 30) / 100.0f; 
+            star_system->g[index] = 0.2f + rng_range(rng, 20) / 100.0f; 
+            star_system->b[index] = 0.9f + rng_range(rng, 10) / 100.0f; 
+            break;
+        case 6: 
+            star_system->r[index] = 0.1f + rng_range(rng, 20) / 100.0f; 
+            star_system->g[index] = 0.8f + rng_range(rng, 20) / 100.0f; 
+            star_system->b[index] = 0.9f + rng_range(rng, 10) / 100.0f; 
+            break;
+        default: 
+            star_system->r[index] = star_system->g[index] = star_system->b[index] = 0.9f + rng_range(rng, 10) / 100.0f; 
+            break;
+    }
+}
+
+void init_star(int index) {
+    StarRng rng = star_rng(index);
+    
+    star_system->x[index] = (float)rng_range(&rng, WINDOW_WIDTH);
+    star_system->y[index] = (float)rng_range(&rng, WINDOW_HEIGHT);
+    star_system->prev_x[index] = star_system->x[index];
+    star_system->prev_y[index] = star_system->y[index];
+    
+    float angle = (float)rng_range(&rng, 360) * PI / 180.0f;
+    float speed = (float)(rng_range(&rng, 30) + 10) / 1000.0f;
+    star_system->vx[index] = cos(angle) * speed;
+    star_system->vy[index] = sin(angle) * speed;
+    
+    star_system->brightness[index] = 0.6f + (float)rng_range(&rng, 40) / 100.0f;
+    star_system->pulse_phase[index] = (float)rng_range(&rng, 360) * PI / 180.0f;
+    star_system->pulse_speed[index] = (float)(rng_range(&rng, 20) + 5) / 10000.0f;
+    star_system->size[index] = 2.0f + (float)rng_range(&rng, 6);
+    star_system->star_type[index] = rng_range(&rng, 4);
+    star_system->glow_intensity[index] = 0.5f + (float)rng_range(&rng, 50) / 100.0f;
+    
+    generate_star_color(index, &rng);
+}
+
+// Snapshots binarios (--load / --save), el mismo formato en los tres builds:
+// cabecera de una página y después las STAR_COLUMNS columnas de la arena, en
+// el orden de star_system_columns(), cada una de column_stride bytes. Se
+// guardan con un solo writev y al cargar el archivo se mapea (copy-on-write)
+// directamente como arena: no hay lectura, conversión ni copia por estrella.
+#define SNAPSHOT_MAGIC "STARSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_BYTES 4096   // Una página: las columnas quedan alineadas para mmap
+#define SNAPSHOT_ENDIAN_TAG 0x01020304u
+#define SNAPSHOT_COLUMNS 16
+
+// Orden de las columnas en el archivo (el de la arena de paralelo2)
+enum {
+    COL_X, COL_Y, COL_VX, COL_VY, COL_BRIGHTNESS, COL_PULSE_PHASE, COL_PULSE_SPEED, COL_SIZE,
+    COL_R, COL_G, COL_B, COL_GLOW, COL_TYPE, COL_GRID_CELL, COL_PREV_X, COL_PREV_Y
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_tag;      // Detecta archivos de otra arquitectura
+    uint32_t header_bytes;    // Desplazamiento de la primera columna
+    uint32_t column_count;
+    uint64_t column_stride;   // Bytes por columna (múltiplo de 64)
+    uint64_t star_count;
+    uint64_t seed;
+    uint64_t sim_steps;
+    uint32_t world_width;
+    uint32_t world_height;
+} SnapshotHeader;
+
+const char* snapshot_load_path = NULL;  // --load ARCHIVO
+const char* snapshot_save_path = NULL;  // --save ARCHIVO (al salir; también tecla S)
+
+static void fill_snapshot_header(char* block, int count, size_t stride) {
+    memset(block, 0, SNAPSHOT_HEADER_BYTES);
+    SnapshotHeader* header = (SnapshotHeader*)block;
+    memcpy(header->magic, SNAPSHOT_MAGIC, 8);
+    header->version = SNAPSHOT_VERSION;
+    header->endian_tag = SNAPSHOT_ENDIAN_TAG;
+    header->header_bytes = SNAPSHOT_HEADER_BYTES;
+    header->column_count = SNAPSHOT_COLUMNS;
+    header->column_stride = stride;
+    header->star_count = (uint64_t)count;
+    header->seed = star_seed;
+    header->sim_steps = (uint64_t)sim_steps;
+    header->world_width = WINDOW_WIDTH;
+    header->world_height = WINDOW_HEIGHT;
+}
+
+static int check_snapshot_header(const SnapshotHeader* header, size_t file_bytes) {
+    if (file_bytes < sizeof(SnapshotHeader) || memcmp(header->magic, SNAPSHOT_MAGIC, 8) != 0) {
+        printf("Error: El archivo no es un snapshot de estrellas\n");
+        return 0;
+    }
+    if (header->version != SNAPSHOT_VERSION || header->endian_tag != SNAPSHOT_ENDIAN_TAG) {
+        printf("Error: Snapshot versión %u incompatible (se espera %d, mismo orden de bytes)\n",
+               header->version, SNAPSHOT_VERSION);
+        return 0;
+    }
+    // Límites sin sumas ni productos de campos del archivo: un column_stride
+    // manipulado podría desbordar header_bytes + stride * columnas
+    if (header->column_count != SNAPSHOT_COLUMNS || header->header_bytes < sizeof(SnapshotHeader) ||
+        header->column_stride % 64 != 0 || header->star_count == 0 || header->star_count > MAX_STARS ||
+        header->star_count * 4 > header->column_stride || header->column_stride / 4 > MAX_STARS ||
+        header->header_bytes > file_bytes ||
+        header->column_stride > (file_bytes - header->header_bytes) / SNAPSHOT_COLUMNS) {
+        printf("Error: Snapshot corrupto o truncado\n");
+        return 0;
+    }
+    if (header->world_width != WINDOW_WIDTH || header->world_height != WINDOW_HEIGHT) {
+        printf("Advertencia: Snapshot de un mundo de %ux%u\n", header->world_width, header->world_height);
+    }
+    return 1;
+}
+
+// Guarda count estrellas: cabecera + una iovec por columna en un solo writev
+int save_snapshot(const char* path) {
+    StarSystem* sys = star_system;
+    int n = sys->count;
+    size_t stride = (size_t)round_capacity(n) * 4;  // <= capacity * 4
+    char header_block[SNAPSHOT_HEADER_BYTES];
+    fill_snapshot_header(header_block, n, stride);
+    
+    void** columns[STAR_COLUMNS];
+    star_system_columns(sys, columns);
+    int ok = 1;
+    
+#ifdef _WIN32
+    FILE* out = fopen(path, "wb");
+    ok = out && fwrite(header_block, 1, SNAPSHOT_HEADER_BYTES, out) == SNAPSHOT_HEADER_BYTES;
+    for (int k = 0; ok && k < STAR_COLUMNS; k++) {
+        ok = fwrite(*columns[k], 1, stride, out) == stride;
+    }
+    if (out && fclose(out) != 0) ok = 0;
+#else
+    struct iovec iov[1 + STAR_COLUMNS];
+    iov[0].iov_base = header_block;
+    iov[0].iov_len = SNAPSHOT_HEADER_BYTES;
+    for (int k = 0; k < STAR_COLUMNS; k++) {
+        iov[1 + k].iov_base = *columns[k];
+        iov[1 + k].iov_len = stride;
+    }
+    
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ok = fd >= 0;
+    int first = 0;
+    while (ok && first < 1 + STAR_COLUMNS) {
+        // writev puede escribir menos de lo pedido con archivos muy grandes
+        ssize_t written = writev(fd, &iov[first], 1 + STAR_COLUMNS - first);
+        if (written < 0) {
+            ok = 0;
+            break;
+        }
+        while (first < 1 + STAR_COLUMNS && (size_t)written >= iov[first].iov_len) {
+            written -= iov[first].iov_len;
+            first++;
+        }
+        if (first < 1 + STAR_COLUMNS) {
+            iov[first].iov_base = (char*)iov[first].iov_base + written;
+            iov[first].iov_len -= written;
+        }
+    }
+    if (fd >= 0 && close(fd) != 0) ok = 0;
+#endif
+    
+    if (ok) printf("Snapshot guardado en %s (%d estrellas, paso %lld)\n", path, n, sim_steps);
+    else printf("Error: No se pudo escribir el snapshot %s\n", path);
+    return ok;
+}
+
+// Lectura columna por columna: Windows, o cabecera que no cae en borde de página
+static StarSystem* read_snapshot_columns(FILE* in, const SnapshotHeader* header) {
+    int n = (int)header->star_count;
+    StarSystem* sys = create_star_system(n);
+    if (!sys) return NULL;
+    
+    void** columns[STAR_COLUMNS];
+    star_system_columns(sys, columns);
+    for (int k = 0; k < STAR_COLUMNS; k++) {
+        off_t offset = (off_t)header->header_bytes + (off_t)k * (off_t)header->column_stride;
+        if (fseeko(in, offset, SEEK_SET) != 0 ||
+            fread(*columns[k], 4, n, in) != (size_t)n) {
+            destroy_star_system(sys);
+            return NULL;
+        }
+    }
+    return sys;
+}
+
+// Lee un snapshot como nuevo StarSystem, o NULL si no se pudo
+static StarSystem* read_snapshot(const char* path, SnapshotHeader* header_out) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        printf("Error: No se pudo abrir el snapshot %s\n", path);
+        return NULL;
+    }
+    
+    SnapshotHeader header;
+    fseeko(in, 0, SEEK_END);
+    off_t end = ftello(in);
+    size_t file_bytes = (end > 0) ? (size_t)end : 0;
+    fseeko(in, 0, SEEK_SET);
+    if (fread(&header, 1, sizeof(header), in) != sizeof(header)) memset(&header, 0, sizeof(header));
+    if (!check_snapshot_header(&header, file_bytes)) {
+        fclose(in);
+        return NULL;
+    }
+    
+    StarSystem* sys = NULL;
+#ifndef _WIN32
+    size_t arena_bytes = header.column_stride * STAR_COLUMNS;
+    if (header.header_bytes % (size_t)sysconf(_SC_PAGESIZE) == 0) {
+        void* arena = mmap(NULL, arena_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                           fileno(in), (off_t)header.header_bytes);
+        if (arena != MAP_FAILED) {
+            sys = (StarSystem*)calloc(1, sizeof(StarSystem));
+            if (!sys) {
+                munmap(arena, arena_bytes);
+                fclose(in);
+                return NULL;
+            }
+            sys->arena = arena;
+            sys->arena_bytes = arena_bytes;
+            sys->arena_mapped = 1;
+            sys->capacity = (int)(header.column_stride / 4);
+            sys->count = (int)header.star_count;
+            assign_star_columns(sys);
+        }
+    }
+#endif
+    if (!sys) sys = read_snapshot_columns(in, &header);
+    fclose(in);
+    if (!sys) {
+        printf("Error: No se pudo cargar el snapshot %s\n", path);
+        return NULL;
+    }
+    
+    *header_out = header;
+    return sys;
+}
+
+// Carga el estado inicial (--load): también recupera semilla y paso
+StarSystem* load_snapshot(const char* path) {
+    SnapshotHeader header;
+    StarSystem* sys = read_snapshot(path, &header);
+    if (!sys) return NULL;
+    
+    star_seed = header.seed;
+    sim_steps = (long long)header.sim_steps;
+    return sys;
+}
+
+// Regresión (--compare GOLDEN): deriva de x, y, vx, vy respecto de un
+// snapshot de referencia al terminar el benchmark headless. El proceso sale
+// con código 2 si la deriva máxima supera --tolerance o el paso no coincide.
+const char* compare_path = NULL;
+double compare_tolerance = 1e-3;
+
+typedef struct {
+    double max;
+    double sum_sq;
+} Drift;
+
+static inline void drift_add(Drift* drift, float value, float golden) {
+    double d = fabs((double)value - (double)golden);
+    if (!(d <= drift->max)) drift->max = d;  // Un NaN también queda como máximo
+    drift->sum_sq += d * d;
+}
+
+// Imprime la deriva por columna; 1 si todo queda dentro de la tolerancia
+static int report_drift(const char* path, const Drift drift[4], int n, uint64_t golden_steps) {
+    static const char* names[4] = { "x", "y", "vx", "vy" };
+    double worst = 0.0;
+    
+    printf("Comparación con %s (%d estrellas, paso %lld, golden en el paso %llu):\n",
+           path, n, sim_steps, (unsigned long long)golden_steps);
+    for (int k = 0; k < 4; k++) {
+        printf("  %-2s  máx %.3e | rms %.3e\n", names[k], drift[k].max, sqrt(drift[k].sum_sq / n));
+        if (!(drift[k].max <= worst)) worst = drift[k].max;
+    }
+    int ok = (uint64_t)sim_steps == golden_steps && worst <= compare_tolerance;
+    printf("Deriva máxima: %.3e (tolerancia %.1e) -> %s\n", worst, compare_tolerance, ok ? "OK" : "FALLA");
+    return ok;
+}
+
+int compare_snapshot(const char* path) {
+    SnapshotHeader header;
+    StarSystem* golden = read_snapshot(path, &header);
+    if (!golden) return 0;
+    int n = star_system->count;
+    if (golden->count != n) {
+        printf("Error: El golden tiene %d estrellas y la simulación %d\n", golden->count, n);
+        destroy_star_system(golden);
+        return 0;
+    }
+    
+    const float* current[4] = { star_system->x, star_system->y, star_system->vx, star_system->vy };
+    const float* reference[4] = { golden->x, golden->y, golden->vx, golden->vy };
+    Drift drift[4];
+    memset(drift, 0, sizeof(drift));
+    for (int k = 0; k < 4; k++) {
+        for (int i = 0; i < n; i++) {
+            drift_add(&drift[k], current[k][i], reference[k][i]);
+        }
+    }
+    
+    int ok = report_drift(path, drift, n, header.sim_steps);
+    destroy_star_system(golden);
+    return ok;
+}
+
+// Grabación de trayectorias (--record ARCHIVO). Tras cada paso de física
+// record_frame() copia las posiciones (y con --record-colors color y brillo)
+// a uno de dos bloques en memoria; un thread escritor codifica y escribe el
+// bloque lleno mientras la simulación llena el otro. La simulación nunca
+// espera al disco: si el escritor sigue ocupado con el otro bloque, el frame
+// se descarta y se cuenta en la cabecera.
+//
+// Archivo: RecordHeader y luego, por frame, RecordFrameHeader + columnas
+// x[n], y[n] (y con color r[n] g[n] b[n] brillo[n], un byte cada uno):
+//   raw:   x, y como float
+//   q16:   x, y cuantizadas a uint16 sobre el ancho/alto del mundo
+//   delta: q16 completo cada RECORD_KEYFRAME_INTERVAL frames o si cambia el
+//          número de estrellas; el resto, diferencia con el frame anterior
+//          en zigzag + varint (1-3 bytes por coordenada)
+#define RECORD_MAGIC "STARREC"
+#define RECORD_VERSION 1
+#define RECORD_BLOCK_BYTES (4 << 20)  // Tamaño de cada bloque (crece si un frame no cabe)
+#define RECORD_KEYFRAME_INTERVAL 60
+#define RECORD_FLAG_COLORS 1u
+
+enum { RECORD_RAW, RECORD_Q16, RECORD_DELTA };
+static const char* record_encoding_names[] = { "raw", "q16", "delta" };
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_tag;
+    uint32_t encoding;
+    uint32_t flags;
+    uint32_t world_width;
+    uint32_t world_height;
+    uint32_t keyframe_interval;
+    uint32_t frame_header_bytes;
+    uint64_t seed;
+    double dt;
+    uint64_t frames;   // frames y dropped se completan al cerrar
+    uint64_t dropped;
+} RecordHeader;
+
+typedef struct {
+    uint64_t step;
+    uint32_t star_count;
+    uint32_t keyframe;        // 0 = delta respecto del frame anterior
+    uint64_t payload_bytes;
+} RecordFrameHeader;
+
+// Frames preparados por la simulación, aún sin codificar
+typedef struct {
+    unsigned char* data;
+    size_t used, capacity;
+} RecordBlock;
+
+typedef struct {
+    FILE* file;
+    RecordBlock blocks[2];
+    RecordBlock* active;      // Lo llena la simulación
+    RecordBlock* pending;     // Entregado al escritor; NULL si está libre
+    int closing;
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;      // Hay bloque pendiente o hay que cerrar
+    pthread_cond_t idle;      // El escritor terminó el bloque pendiente
+    uint64_t frames, dropped;
+    
+    // Estado del escritor: solo lo toca su thread
+    uint16_t* previous;       // Último frame cuantizado (x luego y), para delta
+    int previous_count;
+    uint64_t encoded_frames;
+    unsigned char* encoded;
+    size_t encoded_capacity;
+    uint64_t bytes_written, raw_bytes;
+    double write_seconds;
+    int write_error;
+} Recorder;
+
+Recorder recorder;
+const char* record_path = NULL;
+int record_encoding = RECORD_DELTA;
+int record_colors = 0;
+
+int parse_record_encoding(const char* text) {
+    for (int k = 0; k < 3; k++) {
+        if (strcmp(text, record_encoding_names[k]) == 0) {
+            record_encoding = k;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Bytes de un frame preparado (cabecera + columnas), redondeado a 8
+static size_t record_staged_bytes(int n) {
+    size_t coords = (size_t)n * (record_encoding == RECORD_RAW ? 2 * sizeof(float) : 2 * sizeof(uint16_t));
+    size_t colors = record_colors ? (size_t)n * 4 : 0;
+    return (sizeof(RecordFrameHeader) + coords + colors + 7) & ~(size_t)7;
+}
+
+static inline uint16_t record_quantize(float value, float extent) {
+    float q = value * (65535.0f / extent) + 0.5f;
+    if (q < 0.0f) q = 0.0f;
+    if (q > 65535.0f) q = 65535.0f;
+    return (uint16_t)q;
+}
+
+static inline uint8_t record_unit_byte(float value) {
+    float q = value * 255.0f + 0.5f;
+    if (q < 0.0f) q = 0.0f;
+    if (q > 255.0f) q = 255.0f;
+    return (uint8_t)q;
+}
+
+// Copia el estado de star_system al frame preparado: columnas de posición
+// (float o cuantizadas) y, con color, r g b y brillo actual del pulso
+static void record_stage(unsigned char* payload, int n) {
+    const StarSystem* sys = star_system;
+    int raw = record_encoding == RECORD_RAW;
+    float* fx = (float*)payload;
+    uint16_t* qx = (uint16_t*)payload;
+    unsigned char* color = payload + (size_t)n * (raw ? 8 : 4);
+    
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        if (raw) {
+            fx[i] = sys->x[i];
+            fx[n + i] = sys->y[i];
+        } else {
+            qx[i] = record_quantize(sys->x[i], (float)WINDOW_WIDTH);
+            qx[n + i] = record_quantize(sys->y[i], (float)WINDOW_HEIGHT);
+        }
+        if (record_colors) {
+            color[i] = record_unit_byte(sys->r[i]);
+            color[n + i] = record_unit_byte(sys->g[i]);
+            color[2 * n + i] = record_unit_byte(sys->b[i]);
+            color[3 * n + i] = record_unit_byte(sys->brightness[i] * (0.7f + 0.3f * sinf(sys->pulse_phase[i])));
+        }
+    }
+}
+
+// Diferencias con el frame anterior en zigzag + varint; actualiza previous
+static size_t record_encode_delta(const uint16_t* q, int values, unsigned char* out) {
+    uint16_t* previous = recorder.previous;
+    size_t k = 0;
+    for (int i = 0; i < values; i++) {
+        int16_t delta = (int16_t)(uint16_t)(q[i] - previous[i]);
+        uint16_t z = (uint16_t)((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15);
+        while (z >= 0x80) {
+            out[k++] = (unsigned char)(z | 0x80);
+            z >>= 7;
+        }
+        out[k++] = (unsigned char)z;
+        previous[i] = q[i];
+    }
+    return k;
+}
+
+// Codifica y escribe los frames de un bloque (thread escritor)
+static void record_write_block(const RecordBlock* block) {
+    double start = omp_get_wtime();
+    size_t offset = 0;
+    
+    while (offset < block->used && !recorder.write_error) {
+        RecordFrameHeader header;
+        memcpy(&header, block->data + offset, sizeof(header));
+        int n = (int)header.star_count;
+        const unsigned char* payload = block->data + offset + sizeof(header);
+        size_t coord_bytes = (size_t)n * (record_encoding == RECORD_RAW ? 8 : 4);
+        size_t color_bytes = record_colors ? (size_t)n * 4 : 0;
+        offset += record_staged_bytes(n);
+        
+        const unsigned char* coords = payload;
+        size_t coords_out = coord_bytes;
+        if (record_encoding == RECORD_DELTA) {
+            int keyframe = n != recorder.previous_count ||
+                           recorder.encoded_frames % RECORD_KEYFRAME_INTERVAL == 0;
+            if (keyframe) {
+                uint16_t* previous = (uint16_t*)realloc(recorder.previous, coord_bytes + 1);
+                if (!previous) {
+                    recorder.write_error = 1;
+                    break;
+                }
+                recorder.previous = previous;
+                recorder.previous_count = n;
+                memcpy(previous, payload, coord_bytes);
+            } else {
+                size_t worst = (size_t)n * 2 * 3;
+                if (worst > recorder.encoded_capacity) {
+                    unsigned char* encoded = (unsigned char*)realloc(recorder.encoded, worst);
+                    if (!encoded) {
+                        recorder.write_error = 1;
+                        break;
+                    }
+                    recorder.encoded = encoded;
+                    recorder.encoded_capacity = worst;
+                }
+                coords_out = record_encode_delta((const uint16_t*)payload, 2 * n, recorder.encoded);
+                coords = recorder.encoded;
+            }
+            header.keyframe = keyframe;
+        }
+        recorder.encoded_frames++;
+        header.payload_bytes = coords_out + color_bytes;
+        
+        if (fwrite(&header, sizeof(header), 1, recorder.file) != 1 ||
+            fwrite(coords, 1, coords_out, recorder.file) != coords_out ||
+            fwrite(payload + coord_bytes, 1, color_bytes, recorder.file) != color_bytes) {
+            recorder.write_error = 1;
+        }
+        recorder.bytes_written += sizeof(header) + header.payload_bytes;
+        recorder.raw_bytes += sizeof(header) + (size_t)n * (record_colors ? 6 : 2) * sizeof(float);
+    }
+    recorder.write_seconds += omp_get_wtime() - start;
+}
+
+static void* record_writer(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&recorder.lock);
+    for (;;) {
+        while (!recorder.pending && !recorder.closing) {
+            pthread_cond_wait(&recorder.wake, &recorder.lock);
+        }
+        if (!recorder.pending) break;
+        
+        RecordBlock* block = recorder.pending;
+        pthread_mutex_unlock(&recorder.lock);
+        record_write_block(block);
+        block->used = 0;
+        pthread_mutex_lock(&recorder.lock);
+        recorder.pending = NULL;
+        pthread_cond_signal(&recorder.idle);
+    }
+    pthread_mutex_unlock(&recorder.lock);
+    return NULL;
+}
+
+int record_begin(const char* path) {
+    memset(&recorder, 0, sizeof(recorder));
+    recorder.file = fopen(path, "wb");
+    if (!recorder.file) {
+        printf("Error: No se pudo crear la grabación %s\n", path);
+        return 0;
+    }
+    
+    RecordHeader header;
+    memset(&header, 0, sizeof(header));  // Se reescribe al cerrar
+    for (int k = 0; k < 2; k++) {
+        recorder.blocks[k].data = (unsigned char*)malloc(RECORD_BLOCK_BYTES);
+        recorder.blocks[k].capacity = RECORD_BLOCK_BYTES;
+    }
+    if (!recorder.blocks[0].data || !recorder.blocks[1].data ||
+        fwrite(&header, sizeof(header), 1, recorder.file) != 1) {
+        printf("Error: No se pudo iniciar la grabación %s\n", path);
+        free(recorder.blocks[0].data);
+        free(recorder.blocks[1].data);
+        fclose(recorder.file);
+        recorder.file = NULL;
+        return 0;
+    }
+    recorder.active = &recorder.blocks[0];
+    
+    pthread_mutex_init(&recorder.lock, NULL);
+    pthread_cond_init(&recorder.wake, NULL);
+    pthread_cond_init(&recorder.idle, NULL);
+    if (pthread_create(&recorder.writer, NULL, record_writer, NULL) != 0) {
+        printf("Error: No se pudo crear el thread escritor de la grabación\n");
+        pthread_mutex_destroy(&recorder.lock);
+        pthread_cond_destroy(&recorder.wake);
+        pthread_cond_destroy(&recorder.idle);
+        free(recorder.blocks[0].data);
+        free(recorder.blocks[1].data);
+        fclose(recorder.file);
+        recorder.file = NULL;
+        return 0;
+    }
+    printf("Grabando trayectorias en %s (codificación %s%s)\n",
+           path, record_encoding_names[record_encoding], record_colors ? ", con color" : "");
+    return 1;
+}
+
+// Prepara el frame actual en el bloque activo; entrega el bloque al escritor
+// cuando se llena. Nunca espera: si el escritor está ocupado descarta el frame.
+void record_frame(int n) {
+    if (!recorder.file) return;
+    size_t need = record_staged_bytes(n);
+    RecordBlock* block = recorder.active;
+    
+    if (block->used + need > block->capacity) {
+        if (block->used > 0) {
+            pthread_mutex_lock(&recorder.lock);
+            int busy = recorder.pending != NULL;
+            if (!busy) {
+                recorder.pending = block;
+                recorder.active = (block == &recorder.blocks[0]) ? &recorder.blocks[1] : &recorder.blocks[0];
+                pthread_cond_signal(&recorder.wake);
+            }
+            pthread_mutex_unlock(&recorder.lock);
+            if (busy) {
+                recorder.dropped++;
+                return;
+            }
+            block = recorder.active;
+        }
+        if (need > block->capacity) {
+            // Un solo frame más grande que el bloque: crecer (memoria, no E/S)
+            unsigned char* data = (unsigned char*)realloc(block->data, need);
+            if (!data) {
+                recorder.dropped++;
+                return;
+            }
+            block->data = data;
+            block->capacity = need;
+        }
+    }
+    
+    RecordFrameHeader header = { (uint64_t)sim_steps, (uint32_t)n, 1, 0 };
+    memcpy(block->data + block->used, &header, sizeof(header));
+    record_stage(block->data + block->used + sizeof(header), n);
+    block->used += need;
+    recorder.frames++;
+}
+
+// Entrega el último bloque, espera al escritor y completa la cabecera
+void record_end() {
+    if (!recorder.file) return;
+    
+    pthread_mutex_lock(&recorder.lock);
+    while (recorder.pending) {
+        pthread_cond_wait(&recorder.idle, &recorder.lock);
+    }
+    if (recorder.active->used > 0) recorder.pending = recorder.active;
+    recorder.closing = 1;
+    pthread_cond_signal(&recorder.wake);
+    pthread_mutex_unlock(&recorder.lock);
+    pthread_join(recorder.writer, NULL);
+    
+    RecordHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+    header.version = RECORD_VERSION;
+    header.endian_tag = SNAPSHOT_ENDIAN_TAG;
+    header.encoding = (uint32_t)record_encoding;
+    header.flags = record_colors ? RECORD_FLAG_COLORS : 0;
+    header.world_width = WINDOW_WIDTH;
+    header.world_height = WINDOW_HEIGHT;
+    header.keyframe_interval = RECORD_KEYFRAME_INTERVAL;
+    header.frame_header_bytes = sizeof(RecordFrameHeader);
+    header.seed = star_seed;
+    header.dt = SIM_DT;
+    header.frames = recorder.encoded_frames;
+    header.dropped = recorder.dropped;
+    if (fseek(recorder.file, 0, SEEK_SET) != 0) {
+        printf("Advertencia: La salida no es posicionable; frames y descartados quedan en 0 en la cabecera\n");
+    } else if (fwrite(&header, sizeof(header), 1, recorder.file) != 1) {
+        recorder.write_error = 1;
+    }
+    if (fclose(recorder.file) != 0) recorder.write_error = 1;
+    recorder.file = NULL;
+    
+    if (recorder.write_error) printf("Error: La grabación quedó incompleta (falló la escritura)\n");
+    printf("Grabación: %llu frames (%llu descartados) | %.2f MB (%.1f%% de float) | escritor %.3f s, %.1f MB/s\n",
+           (unsigned long long)recorder.encoded_frames, (unsigned long long)recorder.dropped,
+           recorder.bytes_written / (1024.0 * 1024.0),
+           recorder.raw_bytes ? 100.0 * recorder.bytes_written / recorder.raw_bytes : 0.0,
+           recorder.write_seconds,
+           recorder.write_seconds > 0 ? recorder.bytes_written / (1024.0 * 1024.0) / recorder.write_seconds : 0.0);
+    
+    pthread_mutex_destroy(&recorder.lock);
+    pthread_cond_destroy(&recorder.wake);
+    pthread_cond_destroy(&recorder.idle);
+    free(recorder.blocks[0].data);
+    free(recorder.blocks[1].data);
+    free(recorder.previous);
+    free(recorder.encoded);
+}
+
+// Primer toque NUMA: cada thread escribe (en ceros) su rango estático de
+// todas las columnas, el mismo reparto que usan la inicialización y las
+// copias, para que el sistema operativo ubique esas páginas en el nodo de
+// ese thread. Las páginas de mmap no existen hasta el primer acceso.
+void first_touch_star_system(StarSystem* sys) {
+    void** columns[STAR_COLUMNS];
+    star_system_columns(sys, columns);
+    int capacity = sys->capacity;
+    
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+        int begin = (int)((long long)capacity * tid / nthreads);
+        int end = (int)((long long)capacity * (tid + 1) / nthreads);
+        for (int k = 0; k < STAR_COLUMNS; k++) {
+            memset((char*)*columns[k] + (size_t)begin * 4, 0, (size_t)(end - begin) * 4);
+        }
+    }
+}
+
+// OMP_PROC_BIND y OMP_PLACES se leen al cargar el runtime de OpenMP, antes
+// de main. Si se pidieron por línea de comandos se exportan y el programa se
+// reinicia a sí mismo; devuelve -1 solo si no se pudo reiniciar.
+int apply_affinity_environment(char* argv[]) {
+    const char* bind = getenv("OMP_PROC_BIND");
+    const char* places = getenv("OMP_PLACES");
+    int bind_ok = !requested_bind || (bind && strcmp(bind, requested_bind) == 0);
+    int places_ok = !requested_places || (places && strcmp(places, requested_places) == 0);
+    if (bind_ok && places_ok) return 0;
+    
+#ifdef _WIN32
+    printf("Advertencia: en Windows exporte OMP_PROC_BIND/OMP_PLACES antes de iniciar; se ignoran --bind/--places\n");
+    return 0;
+#else
+    if (requested_bind) setenv("OMP_PROC_BIND", requested_bind, 1);
+    if (requested_places) setenv("OMP_PLACES", requested_places, 1);
+    fflush(stdout);
+#ifdef __linux__
+    execv("/proc/self/exe", argv);
+#endif
+    execvp(argv[0], argv);
+    printf("Error: No se pudo reiniciar con OMP_PROC_BIND/OMP_PLACES\n");
+    return -1;
+#endif
+}
+
+static const char* proc_bind_name(omp_proc_bind_t bind) {
+    switch (bind) {
+        case omp_proc_bind_false: return "false";
+        case omp_proc_bind_true: return "true";
+        case omp_proc_bind_master: return "master";
+        case omp_proc_bind_close: return "close";
+        case omp_proc_bind_spread: return "spread";
+        default: return "?";
+    }
+}
+
+static int current_cpu() {
+#if defined(__linux__)
+    return sched_getcpu();
+#elif defined(_WIN32)
+    return (int)GetCurrentProcessorNumber();
+#else
+    return -1;
+#endif
+}
+
+// Binding efectivo y dónde quedó cada thread (place de OpenMP y CPU actual)
+void report_affinity() {
+    int threads = omp_get_max_threads();
+    const char* places_env = getenv("OMP_PLACES");
+    printf("Threads: %d | Binding: %s | Places: %d (%s)\n", threads, proc_bind_name(omp_get_proc_bind()),
+           omp_get_num_places(), places_env ? places_env : "sin OMP_PLACES");
+    
+    int* places = (int*)malloc(threads * sizeof(int));
+    int* cpus = (int*)malloc(threads * sizeof(int));
+    if (!places || !cpus) {
+        free(places);
+        free(cpus);
+        return;
+    }
+    
+    #pragma omp parallel num_threads(threads)
+    {
+        int tid = omp_get_thread_num();
+        places[tid] = omp_get_place_num();
+        cpus[tid] = current_cpu();
+    }
+    
+    for (int t = 0; t < threads; t++) {
+        printf("  thread %d -> place %d, CPU %d\n", t, places[t], cpus[t]);
+    }
+    free(places);
+    free(cpus);
+}
+
+// Reconstrucción del grid por counting sort paralelo: cada thread arma el
+// histograma de celdas de su bloque estático de estrellas, una suma prefija
+// por (celda, thread) da a cada thread su rango dentro de cada celda y luego
+// cada uno dispersa sus índices sin locks. No se descarta ninguna estrella y
+// el orden dentro de cada celda es estable (por índice de estrella).
+void update_spatial_grid() {
+    SpatialGrid* grid = spatial_grid;
+    int n = star_system->count;
+    int total_cells = grid->total_cells;
+    
+    if (!reserve_spatial_grid(grid, n, omp_get_max_threads())) {
+        printf("Error: No se pudo allocar memoria para el grid espacial\n");
+        memset(grid->cell_start, 0, (total_cells + 1) * sizeof(int));
+        return;
+    }
+    
+    double phase_start = omp_get_wtime();
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+        int begin = (int)((long long)n * tid / nthreads);
+        int end = (int)((long long)n * (tid + 1) / nthreads);
+        int* histogram = &grid->thread_histograms[tid * total_cells];
+        
+        double t0 = omp_get_wtime();
+        memset(histogram, 0, total_cells * sizeof(int));
+        for (int i = begin; i < end; i++) {
+            int grid_x = (int)(star_system->x[i] / GRID_SIZE);
+            int grid_y = (int)(star_system->y[i] / GRID_SIZE);
+            
+            grid_x = (grid_x < 0) ? 0 : ((grid_x >= grid->width) ? grid->width - 1 : grid_x);
+            grid_y = (grid_y < 0) ? 0 : ((grid_y >= grid->height) ? grid->height - 1 : grid_y);
+            
+            int cell_index = grid_y * grid->width + grid_x;
+            star_system->grid_cell[i] = cell_index;
+            histogram[cell_index]++;
+        }
+        double busy = trace_segment(PHASE_GRID, t0);
+        
+        #pragma omp barrier
+        
+        // Por celda: desplazamiento de cada thread dentro de la celda y total
+        #pragma omp for schedule(static)
+        for (int c = 0; c < total_cells; c++) {
+            int sum = 0;
+            for (int t = 0; t < nthreads; t++) {
+                int count = grid->thread_histograms[t * total_cells + c];
+                grid->thread_histograms[t * total_cells + c] = sum;
+                sum += count;
+            }
+            grid->cell_start[c + 1] = sum;
+        }
+        
+        // Suma prefija sobre las celdas (pocas celdas: un solo thread)
+        #pragma omp single
+        {
+            grid->cell_start[0] = 0;
+            for (int c = 0; c < total_cells; c++) {
+                grid->cell_start[c + 1] += grid->cell_start[c];
+            }
+        }
+        
+        t0 = omp_get_wtime();
+        for (int i = begin; i < end; i++) {
+            int cell_index = star_system->grid_cell[i];
+            grid->star_indices[grid->cell_start[cell_index] + histogram[cell_index]++] = i;
+        }
+        profile_thread_add(PHASE_GRID, busy + trace_segment(PHASE_GRID, t0));
+    }
+    profile_end(PHASE_GRID, phase_start);
+}
+
+// Permuta todas las columnas del SoA al orden de celdas del grid, para que
+// las estrellas vecinas queden contiguas en memoria y las lecturas de
+// x[star_b]/y[star_b] en las interacciones usen líneas de caché consecutivas.
+// Se escribe en un sistema auxiliar y luego se intercambian los punteros.
+void reorder_star_system_by_cell() {
+    int n = star_system->count;
+    
+    if (!reorder_scratch) {
+        reorder_scratch = create_star_system(star_system->capacity);
+        if (!reorder_scratch) return;
+    }
+    reorder_scratch->count = 0;  // Nada que conservar al crecer
+    if (!reserve_star_system(reorder_scratch, star_system->capacity)) return;
+    
+    StarSystem* src = star_system;
+    StarSystem* dst = reorder_scratch;
+    const int* __restrict__ order = spatial_grid->star_indices;
+    
+    #pragma omp parallel for schedule(static)
+    for (int k = 0; k < n; k++) {
+        int i = order[k];
+        dst->x[k] = src->x[i];
+        dst->y[k] = src->y[i];
+        dst->vx[k] = src->vx[i];
+        dst->vy[k] = src->vy[i];
+        dst->brightness[k] = src->brightness[i];
+        dst->pulse_phase[k] = src->pulse_phase[i];
+        dst->pulse_speed[k] = src->pulse_speed[i];
+        dst->size[k] = src->size[i];
+        dst->r[k] = src->r[i];
+        dst->g[k] = src->g[i];
+        dst->b[k] = src->b[i];
+        dst->glow_intensity[k] = src->glow_intensity[i];
+        dst->star_type[k] = src->star_type[i];
+        dst->grid_cell[k] = src->grid_cell[i];
+        dst->prev_x[k] = src->prev_x[i];
+        dst->prev_y[k] = src->prev_y[i];
+    }
+    
+    StarSystem tmp = *star_system;
+    *star_system = *reorder_scratch;
+    *reorder_scratch = tmp;
+    star_system->count = n;
+    
+    front_static_dirty = 1;
+    
+    // Tras la permutación el grid queda en orden identidad
+    #pragma omp parallel for schedule(static)
+    for (int k = 0; k < n; k++) {
+        spatial_grid->star_indices[k] = k;
+    }
+}
+
+void reorder_if_due(long long step) {
+    if (reorder_interval > 0 && step % reorder_interval == 0) {
+        double start = omp_get_wtime();
+        reorder_star_system_by_cell();
+        trace_event("reorden", "fase", start, omp_get_wtime());
+    }
+}
+
+// Constantes de la física compartidas por todas las variantes del kernel
+#define PHYSICS_DAMPING 0.98f
+#define PHYSICS_FORCE 0.000005f
+#define PHYSICS_BLOCK 256  // Estrellas por bloque de trabajo de OpenMP
+
+// Kernel de física sobre el rango [begin, end). Hay una versión escalar de
+// referencia y variantes SSE2/AVX2/AVX-512 escritas a mano; la variante se
+// elige al arrancar según CPUID (select_physics_kernel)
+typedef void (*PhysicsKernel)(StarSystem* sys, int begin, int end);
+
+void physics_kernel_scalar(StarSystem* sys, int begin, int end) {
+    const float center_x = WINDOW_WIDTH / 2.0f;
+    const float center_y = WINDOW_HEIGHT / 2.0f;
+    const float two_pi = 2.0f * PI;
+    const float window_width_f = (float)WINDOW_WIDTH;
+    const float window_height_f = (float)WINDOW_HEIGHT;
+    
+    for (int i = begin; i < end; i++) {
+        sys->x[i] += sys->vx[i];
+        sys->y[i] += sys->vy[i];
+        float size = sys->size[i];
+        
+        if (sys->x[i] <= size || sys->x[i] >= window_width_f - size) {
+            sys->vx[i] *= -PHYSICS_DAMPING;
+            sys->x[i] = (sys->x[i] <= size) ? size : window_width_f - size;
+        }
+        
+        if (sys->y[i] <= size || sys->y[i] >= window_height_f - size) {
+            sys->vy[i] *= -PHYSICS_DAMPING;
+            sys->y[i] = (sys->y[i] <= size) ? size : window_height_f - size;
+        }
+        
+        sys->pulse_phase[i] += sys->pulse_speed[i];
+        if (sys->pulse_phase[i] > two_pi) {
+            sys->pulse_phase[i] -= two_pi;
+        }
+        
+        float dist_x = center_x - sys->x[i];
+        float dist_y = center_y - sys->y[i];
+        float distance = sqrtf(dist_x * dist_x + dist_y * dist_y);
+        
+        if (distance > 0.0f) {
+            float inv_distance = 1.0f / distance;
+            sys->vx[i] += (dist_x * inv_distance) * PHYSICS_FORCE;
+            sys->vy[i] += (dist_y * inv_distance) * PHYSICS_FORCE;
+        }
+    }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD 1
+
+// SSE2 (línea base de x86-64): mezcla con máscaras and/andnot/or
+static inline __m128 sse_select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));  // mask ? a : b
+}
+
+void physics_kernel_sse(StarSystem* sys, int begin, int end) {
+    const __m128 center_x = _mm_set1_ps(WINDOW_WIDTH / 2.0f);
+    const __m128 center_y = _mm_set1_ps(WINDOW_HEIGHT / 2.0f);
+    const __m128 two_pi = _mm_set1_ps(2.0f * PI);
+    const __m128 width = _mm_set1_ps((float)WINDOW_WIDTH);
+    const __m128 height = _mm_set1_ps((float)WINDOW_HEIGHT);
+    const __m128 neg_damping = _mm_set1_ps(-PHYSICS_DAMPING);
+    const __m128 force = _mm_set1_ps(PHYSICS_FORCE);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 three_halves = _mm_set1_ps(1.5f);
+    const __m128 zero = _mm_setzero_ps();
+    
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 size = _mm_loadu_ps(&sys->size[i]);
+        __m128 vx = _mm_loadu_ps(&sys->vx[i]);
+        __m128 vy = _mm_loadu_ps(&sys->vy[i]);
+        __m128 x = _mm_add_ps(_mm_loadu_ps(&sys->x[i]), vx);
+        __m128 y = _mm_add_ps(_mm_loadu_ps(&sys->y[i]), vy);
+        
+        // Rebote en los bordes sin saltos: se calcula todo y se mezcla
+        __m128 max_x = _mm_sub_ps(width, size);
+        __m128 low_x = _mm_cmple_ps(x, size);
+        __m128 hit_x = _mm_or_ps(low_x, _mm_cmpge_ps(x, max_x));
+        vx = sse_select(hit_x, _mm_mul_ps(vx, neg_damping), vx);
+        x = sse_select(hit_x, sse_select(low_x, size, max_x), x);
+        
+        __m128 max_y = _mm_sub_ps(height, size);
+        __m128 low_y = _mm_cmple_ps(y, size);
+        __m128 hit_y = _mm_or_ps(low_y, _mm_cmpge_ps(y, max_y));
+        vy = sse_select(hit_y, _mm_mul_ps(vy, neg_damping), vy);
+        y = sse_select(hit_y, sse_select(low_y, size, max_y), y);
+        
+        __m128 phase = _mm_add_ps(_mm_loadu_ps(&sys->pulse_phase[i]), _mm_loadu_ps(&sys->pulse_speed[i]));
+        phase = sse_select(_mm_cmpgt_ps(phase, two_pi), _mm_sub_ps(phase, two_pi), phase);
+        
+        // Atracción al centro: rsqrt aproximado + un paso de Newton-Raphson
+        __m128 dx = _mm_sub_ps(center_x, x);
+        __m128 dy = _mm_sub_ps(center_y, y);
+        __m128 dist_sq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 inv = _mm_rsqrt_ps(dist_sq);
+        inv = _mm_mul_ps(inv, _mm_sub_ps(three_halves, _mm_mul_ps(_mm_mul_ps(half, dist_sq), _mm_mul_ps(inv, inv))));
+        inv = _mm_and_ps(_mm_cmpgt_ps(dist_sq, zero), inv);  // distancia 0: sin fuerza
+        __m128 scale = _mm_mul_ps(inv, force);
+        vx = _mm_add_ps(vx, _mm_mul_ps(dx, scale));
+        vy = _mm_add_ps(vy, _mm_mul_ps(dy, scale));
+        
+        _mm_storeu_ps(&sys->x[i], x);
+        _mm_storeu_ps(&sys->y[i], y);
+        _mm_storeu_ps(&sys->vx[i], vx);
+        _mm_storeu_ps(&sys->vy[i], vy);
+        _mm_storeu_ps(&sys->pulse_phase[i], phase);
+    }
+    physics_kernel_scalar(sys, i, end);
+}
+
+__attribute__((target("avx2,fma")))
+void physics_kernel_avx2(StarSystem* sys, int begin, int end) {
+    const __m256 center_x = _mm256_set1_ps(WINDOW_WIDTH / 2.0f);
+    const __m256 center_y = _mm256_set1_ps(WINDOW_HEIGHT / 2.0f);
+    const __m256 two_pi = _mm256_set1_ps(2.0f * PI);
+    const __m256 width = _mm256_set1_ps((float)WINDOW_WIDTH);
+    const __m256 height = _mm256_set1_ps((float)WINDOW_HEIGHT);
+    const __m256 neg_damping = _mm256_set1_ps(-PHYSICS_DAMPING);
+    const __m256 force = _mm256_set1_ps(PHYSICS_FORCE);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 three_halves = _mm256_set1_ps(1.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 size = _mm256_loadu_ps(&sys->size[i]);
+        __m256 vx = _mm256_loadu_ps(&sys->vx[i]);
+        __m256 vy = _mm256_loadu_ps(&sys->vy[i]);
+        __m256 x = _mm256_add_ps(_mm256_loadu_ps(&sys->x[i]), vx);
+        __m256 y = _mm256_add_ps(_mm256_loadu_ps(&sys->y[i]), vy);
+        
+        __m256 max_x = _mm256_sub_ps(width, size);
+        __m256 low_x = _mm256_cmp_ps(x, size, _CMP_LE_OQ);
+        __m256 hit_x = _mm256_or_ps(low_x, _mm256_cmp_ps(x, max_x, _CMP_GE_OQ));
+        vx = _mm256_blendv_ps(vx, _mm256_mul_ps(vx, neg_damping), hit_x);
+        x = _mm256_blendv_ps(x, _mm256_blendv_ps(max_x, size, low_x), hit_x);
+        
+        __m256 max_y = _mm256_sub_ps(height, size);
+        __m256 low_y = _mm256_cmp_ps(y, size, _CMP_LE_OQ);
+        __m256 hit_y = _mm256_or_ps(low_y, _mm256_cmp_ps(y, max_y, _CMP_GE_OQ));
+        vy = _mm256_blendv_ps(vy, _mm256_mul_ps(vy, neg_damping), hit_y);
+        y = _mm256_blendv_ps(y, _mm256_blendv_ps(max_y, size, low_y), hit_y);
+        
+        __m256 phase = _mm256_add_ps(_mm256_loadu_ps(&sys->pulse_phase[i]), _mm256_loadu_ps(&sys->pulse_speed[i]));
+        phase = _mm256_blendv_ps(phase, _mm256_sub_ps(phase, two_pi), _mm256_cmp_ps(phase, two_pi, _CMP_GT_OQ));
+        
+        __m256 dx = _mm256_sub_ps(center_x, x);
+        __m256 dy = _mm256_sub_ps(center_y, y);
+        __m256 dist_sq = _mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy));
+        __m256 inv = _mm256_rsqrt_ps(dist_sq);
+        inv = _mm256_mul_ps(inv, _mm256_fnmadd_ps(_mm256_mul_ps(half, dist_sq), _mm256_mul_ps(inv, inv), three_halves));
+        inv = _mm256_and_ps(_mm256_cmp_ps(dist_sq, zero, _CMP_GT_OQ), inv);
+        __m256 scale = _mm256_mul_ps(inv, force);
+        vx = _mm256_fmadd_ps(dx, scale, vx);
+        vy = _mm256_fmadd_ps(dy, scale, vy);
+        
+        _mm256_storeu_ps(&sys->x[i], x);
+        _mm256_storeu_ps(&sys->y[i], y);
+        _mm256_storeu_ps(&sys->vx[i], vx);
+        _mm256_storeu_ps(&sys->vy[i], vy);
+        _mm256_storeu_ps(&sys->pulse_phase[i], phase);
+    }
+    physics_kernel_scalar(sys, i, end);
+}
+
+__attribute__((target("avx512f")))
+void physics_kernel_avx512(StarSystem* sys, int begin, int end) {
+    const __m512 center_x = _mm512_set1_ps(WINDOW_WIDTH / 2.0f);
+    const __m512 center_y = _mm512_set1_ps(WINDOW_HEIGHT / 2.0f);
+    const __m512 two_pi = _mm512_set1_ps(2.0f * PI);
+    const __m512 width = _mm512_set1_ps((float)WINDOW_WIDTH);
+    const __m512 height = _mm512_set1_ps((float)WINDOW_HEIGHT);
+    const __m512 neg_damping = _mm512_set1_ps(-PHYSICS_DAMPING);
+    const __m512 force = _mm512_set1_ps(PHYSICS_FORCE);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 three_halves = _mm512_set1_ps(1.5f);
+    const __m512 zero = _mm512_setzero_ps();
+    
+    int i = begin;
+    for (; i + 16 <= end; i += 16) {
+        __m512 size = _mm512_loadu_ps(&sys->size[i]);
+        __m512 vx = _mm512_loadu_ps(&sys->vx[i]);
+        __m512 vy = _mm512_loadu_ps(&sys->vy[i]);
+        __m512 x = _mm512_add_ps(_mm512_loadu_ps(&sys->x[i]), vx);
+        __m512 y = _mm512_add_ps(_mm512_loadu_ps(&sys->y[i]), vy);
+        
+        // Registros de máscara: las escrituras enmascaradas reemplazan a los saltos
+        __m512 max_x = _mm512_sub_ps(width, size);
+        __mmask16 low_x = _mm512_cmp_ps_mask(x, size, _CMP_LE_OQ);
+        __mmask16 hit_x = low_x | _mm512_cmp_ps_mask(x, max_x, _CMP_GE_OQ);
+        vx = _mm512_mask_mul_ps(vx, hit_x, vx, neg_damping);
+        x = _mm512_mask_blend_ps(hit_x, x, _mm512_mask_blend_ps(low_x, max_x, size));
+        
+        __m512 max_y = _mm512_sub_ps(height, size);
+        __mmask16 low_y = _mm512_cmp_ps_mask(y, size, _CMP_LE_OQ);
+        __mmask16 hit_y = low_y | _mm512_cmp_ps_mask(y, max_y, _CMP_GE_OQ);
+        vy = _mm512_mask_mul_ps(vy, hit_y, vy, neg_damping);
+        y = _mm512_mask_blend_ps(hit_y, y, _mm512_mask_blend_ps(low_y, max_y, size));
+        
+        __m512 phase = _mm512_add_ps(_mm512_loadu_ps(&sys->pulse_phase[i]), _mm512_loadu_ps(&sys->pulse_speed[i]));
+        phase = _mm512_mask_sub_ps(phase, _mm512_cmp_ps_mask(phase, two_pi, _CMP_GT_OQ), phase, two_pi);
+        
+        __m512 dx = _mm512_sub_ps(center_x, x);
+        __m512 dy = _mm512_sub_ps(center_y, y);
+        __m512 dist_sq = _mm512_fmadd_ps(dx, dx, _mm512_mul_ps(dy, dy));
+        __m512 inv = _mm512_rsqrt14_ps(dist_sq);
+        inv = _mm512_mul_ps(inv, _mm512_fnmadd_ps(_mm512_mul_ps(half, dist_sq), _mm512_mul_ps(inv, inv), three_halves));
+        inv = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(dist_sq, zero, _CMP_GT_OQ), inv);
+        __m512 scale = _mm512_mul_ps(inv, force);
+        vx = _mm512_fmadd_ps(dx, scale, vx);
+        vy = _mm512_fmadd_ps(dy, scale, vy);
+        
+        _mm512_storeu_ps(&sys->x[i], x);
+        _mm512_storeu_ps(&sys->y[i], y);
+        _mm512_storeu_ps(&sys->vx[i], vx);
+        _mm512_storeu_ps(&sys->vy[i], vy);
+        _mm512_storeu_ps(&sys->pulse_phase[i], phase);
+    }
+    physics_kernel_scalar(sys, i, end);
+}
+#endif
+
+PhysicsKernel physics_kernel = physics_kernel_scalar;
+const char* physics_kernel_name = "escalar";
+
+// Elige la variante más ancha que soporte el CPU
+void select_physics_kernel() {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        physics_kernel = physics_kernel_avx512;
+        physics_kernel_name = "AVX-512";
+    } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        physics_kernel = physics_kernel_avx2;
+        physics_kernel_name = "AVX2";
+    } else {
+        physics_kernel = physics_kernel_sse;
+        physics_kernel_name = "SSE2";
+    }
+#endif
+}
+
+void apply_physics_optimized() {
+    int n = star_system->count;
+    int blocks = (n + PHYSICS_BLOCK - 1) / PHYSICS_BLOCK;
+    
+    double phase_start = omp_get_wtime();
+    use_schedule(&physics_schedule);
+    #pragma omp parallel
+    {
+        double t0 = omp_get_wtime();
+        #pragma omp for schedule(runtime) nowait
+        for (int block = 0; block < blocks; block++) {
+            int begin = block * PHYSICS_BLOCK;
+            int end = (begin + PHYSICS_BLOCK < n) ? begin + PHYSICS_BLOCK : n;
+            physics_kernel(star_system, begin, end);
+        }
+        profile_thread_add(PHASE_PHYSICS, trace_segment(PHASE_PHYSICS, t0));
+    }
+    profile_end(PHASE_PHYSICS, phase_start);
+}
+
+// Autoprueba (--selftest-simd): corre cada variante disponible desde el mismo
+// estado inicial y compara contra el kernel escalar de referencia
+int run_simd_selftest(int num_stars) {
+    const int steps = 1000;
+    const float tolerance = 1e-3f;
+    StarSystem* reference = create_star_system(num_stars);
+    StarSystem* candidate = create_star_system(num_stars);
+    StarSystem* saved = star_system;
+    if (!reference || !candidate) {
+        printf("Error: No se pudo allocar memoria para la autoprueba\n");
+        destroy_star_system(reference);
+        destroy_star_system(candidate);
+        return 1;
+    }
+    
+    star_system = reference;
+    for (int i = 0; i < num_stars; i++) init_star(i);
+    star_system = saved;
+    
+    struct { const char* name; PhysicsKernel kernel; int supported; } variants[] = {
+#ifdef HAVE_X86_SIMD
+        { "SSE2", physics_kernel_sse, 1 },
+        { "AVX2", physics_kernel_avx2, __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") },
+        { "AVX-512", physics_kernel_avx512, __builtin_cpu_supports("avx512f") },
+#endif
+        { NULL, NULL, 0 }
+    };
+    
+    // Estado inicial común para todas las variantes
+    size_t bytes = (size_t)num_stars * sizeof(float);
+    float* initial[5];
+    float* reference_columns[5] = { reference->x, reference->y, reference->vx, reference->vy, reference->pulse_phase };
+    float* candidate_columns[5] = { candidate->x, candidate->y, candidate->vx, candidate->vy, candidate->pulse_phase };
+    for (int c = 0; c < 5; c++) {
+        initial[c] = (float*)malloc(bytes);
+        if (!initial[c]) {
+            printf("Error: No se pudo allocar memoria para la autoprueba\n");
+            for (int k = 0; k < c; k++) free(initial[k]);
+            destroy_star_system(reference);
+            destroy_star_system(candidate);
+            return 1;
+        }
+        memcpy(initial[c], reference_columns[c], bytes);
+    }
+    memcpy(candidate->size, reference->size, bytes);
+    memcpy(candidate->pulse_speed, reference->pulse_speed, bytes);
+    
+    for (int s = 0; s < steps; s++) physics_kernel_scalar(reference, 0, num_stars);
+    
+    int failures = 0;
+    for (int v = 0; variants[v].name; v++) {
+        if (!variants[v].supported) {
+            printf("%-8s no soportado por este CPU, omitido\n", variants[v].name);
+            continue;
+        }
+        for (int c = 0; c < 5; c++) memcpy(candidate_columns[c], initial[c], bytes);
+        
+        for (int s = 0; s < steps; s++) variants[v].kernel(candidate, 0, num_stars);
+        
+        float max_pos = 0.0f, max_vel = 0.0f;
+        for (int i = 0; i < num_stars; i++) {
+            max_pos = fmaxf(max_pos, fabsf(candidate->x[i] - reference->x[i]));
+            max_pos = fmaxf(max_pos, fabsf(candidate->y[i] - reference->y[i]));
+            max_vel = fmaxf(max_vel, fabsf(candidate->vx[i] - reference->vx[i]));
+            max_vel = fmaxf(max_vel, fabsf(candidate->vy[i] - reference->vy[i]));
+        }
+        int ok = max_pos <= tolerance && max_vel <= tolerance;
+        printf("%-8s max |dpos| = %.3e  max |dvel| = %.3e  %s\n",
+               variants[v].name, max_pos, max_vel, ok ? "OK" : "FALLO");
+        if (!ok) failures++;
+    }
+    
+    for (int c = 0; c < 5; c++) free(initial[c]);
+    destroy_star_system(reference);
+    destroy_star_system(candidate);
+    return failures ? 1 : 0;
+}
+
+// Kernel de interacciones solo-lectura de vecinos ("gather"): cada estrella
+// suma la fuerza de todas las estrellas de su celda y de las 8 celdas vecinas
+// y escribe únicamente su propia velocidad. Como x/y solo se leen, no hay
+// carreras ni atómicos, y el orden de suma por estrella es fijo, así que el
+// resultado es determinista con cualquier número de threads. El radio de
+// interacción (50) es menor que GRID_SIZE, por lo que el vecindario 3x3 es completo.
+void apply_star_interactions() {
+    if (!interactions_enabled) return;
+    
+    const float interaction_radius = 50.0f;
+    const float interaction_strength = 0.000001f;
+    const float radius_sq = interaction_radius * interaction_radius;
+    const int grid_width = spatial_grid->width;
+    const int grid_height = spatial_grid->height;
+    const int* __restrict__ cell_start = spatial_grid->cell_start;
+    const int* __restrict__ star_indices = spatial_grid->star_indices;
+    
+    double phase_start = omp_get_wtime();
+    use_schedule(&interactions_schedule);
+    #pragma omp parallel
+    {
+        double t0 = omp_get_wtime();
+        #pragma omp for schedule(runtime) collapse(2) nowait
+        for (int gy = 0; gy < grid_height; gy++) {
+            for (int gx = 0; gx < grid_width; gx++) {
+                int cell_index = gy * grid_width + gx;
+                
+                // Rango de celdas vecinas recortado a los bordes del grid
+                int min_gx = (gx > 0) ? gx - 1 : 0;
+                int max_gx = (gx < grid_width - 1) ? gx + 1 : gx;
+                int min_gy = (gy > 0) ? gy - 1 : 0;
+                int max_gy = (gy < grid_height - 1) ? gy + 1 : gy;
+                
+                for (int i = cell_start[cell_index]; i < cell_start[cell_index + 1]; i++) {
+                    int star_a = star_indices[i];
+                    float ax = star_system->x[star_a];
+                    float ay = star_system->y[star_a];
+                    float fx = 0.0f;
+                    float fy = 0.0f;
+                    
+                    for (int ny = min_gy; ny <= max_gy; ny++) {
+                        for (int nx = min_gx; nx <= max_gx; nx++) {
+                            int neighbor_index = ny * grid_width + nx;
+                            int neighbor_end = cell_start[neighbor_index + 1];
+                            
+                            for (int k = cell_start[neighbor_index]; k < neighbor_end; k++) {
+                                int star_b = star_indices[k];
+                                float dx = ax - star_system->x[star_b];
+                                float dy = ay - star_system->y[star_b];
+                                float distance_sq = dx * dx + dy * dy;
+                                
+                                // distance_sq > 0.1 también excluye a la propia estrella
+                                if (distance_sq < radius_sq && distance_sq > 0.1f) {
+                                    float force = interaction_strength / sqrtf(distance_sq);
+                                    fx += dx * force;
+                                    fy += dy * force;
+                                }
+                            }
+                        }
+                    }
+                    
+                    star_system->vx[star_a] += fx;
+                    star_system->vy[star_a] += fy;
+                }
+            }
+        }
+        profile_thread_add(PHASE_INTERACTIONS, trace_segment(PHASE_INTERACTIONS, t0));
+    }
+    profile_end(PHASE_INTERACTIONS, phase_start);
+}
+
+// Vértice intercalado (posición + color RGBA) para arreglos de vértices
+typedef struct {
+    float x, y;
+    float r, g, b, a;
+} Vertex;
+
+// Vértice de sprite (posición + coordenada en el atlas + color RGBA)
+typedef struct {
+    float x, y;
+    float u, v;
+    float r, g, b, a;
+} SpriteVertex;
+
+// Buffer de vértices persistente: se reutiliza frame a frame y solo crece
+typedef struct {
+    Vertex* vertices;
+    int vertex_count;
+    int vertex_capacity;
+} VertexBuffer;
+
+typedef struct {
+    SpriteVertex* vertices;
+    int vertex_count;
+    int vertex_capacity;
+} SpriteBuffer;
+
+// Un buffer por tipo de primitiva; se dibujan con un puñado de draw calls
+typedef struct {
+    SpriteBuffer glow;       // GL_QUADS: sprites de brillo del atlas
+    VertexBuffer lines;      // GL_LINES: cruces, diagonales, rayos y contornos
+    VertexBuffer points[3];  // GL_POINTS de tamaño 3, 4 y 5 (tipos 0, 1 y 2)
+} RenderBatch;
+
+// Posición de escritura dentro de cada buffer del lote
+typedef struct {
+    int glow;
+    int line;
+    int point[3];
+} BatchCursor;
+
+// Atlas de brillo: una celda por tipo de estrella con la suma de todas sus
+// capas (cada capa baja linealmente de su alpha en el centro a 0 en su
+// radio). Las capas de un tipo escalan todas con size, así que un quad
+// del radio de la capa mayor las reemplaza: 4 vértices por estrella en vez
+// de un abanico de 17 vértices por capa.
+#define GLOW_ATLAS_CELL 64
+#define GLOW_ATLAS_WIDTH (GLOW_ATLAS_CELL * 4)
+#define GLOW_MAX_LAYERS 3
+#define GLOW_QUAD_VERTICES 4
+
+// Capas de brillo por tipo: radio en unidades de size y alpha por glow_intensity
+static const int glow_layers_by_type[4] = { 2, 1, 3, 2 };
+static const float glow_layer_radius[4][GLOW_MAX_LAYERS] = {
+    { 3.0f, 2.0f }, { 4.0f }, { 5.0f, 3.0f, 1.5f }, { 6.0f, 3.0f }
+};
+static const float glow_layer_alpha[4][GLOW_MAX_LAYERS] = {
+    { 0.1f, 0.2f }, { 0.15f }, { 0.08f, 0.15f, 0.3f }, { 0.05f, 0.1f }
+};
+
+unsigned char glow_atlas[GLOW_ATLAS_CELL][GLOW_ATLAS_WIDTH];  // GL_ALPHA, fila 0 en v = 0
+float glow_sprite_radius[4];       // Radio del quad (capa mayor) en unidades de size
+float glow_sprite_alpha[4];        // Alpha en el centro (suma de capas) por glow_intensity
+float glow_sprite_u0[4], glow_sprite_u1[4];
+float glow_sprite_v0, glow_sprite_v1;
+GLuint glow_texture = 0;
+
+// Vértices de línea fijos por tipo de estrella
+static const int line_vertices_by_type[4] = { 4, 8, 16, 20 };
+
+// Tablas del círculo unitario para los ángulos fijos de la geometría:
+// las formas se construyen con escala y desplazamiento, sin llamar a libm
+#define RAY_COUNT 8
+#define SHAPE_POINTS 10
+
+float ray_cos[RAY_COUNT], ray_sin[RAY_COUNT];
+float ray_phase_cos[RAY_COUNT], ray_phase_sin[RAY_COUNT];  // cos(i), sin(i) para sin(fase + i)
+float shape_cos[SHAPE_POINTS], shape_sin[SHAPE_POINTS];
+
+void init_trig_tables() {
+    for (int i = 0; i < RAY_COUNT; i++) {
+        ray_cos[i] = (float)cos(2.0 * PI * i / RAY_COUNT);
+        ray_sin[i] = (float)sin(2.0 * PI * i / RAY_COUNT);
+        ray_phase_cos[i] = (float)cos((double)i);
+        ray_phase_sin[i] = (float)sin((double)i);
+    }
+    for (int i = 0; i < SHAPE_POINTS; i++) {
+        shape_cos[i] = (float)cos(2.0 * PI * i / SHAPE_POINTS);
+        shape_sin[i] = (float)sin(2.0 * PI * i / SHAPE_POINTS);
+    }
+}
+
+// Calcula el perfil radial de cada celda del atlas. Los texels del borde de
+// la celda caen justo sobre el radio del quad (alpha 0) y las coordenadas
+// de textura van de centro a centro de esos texels, así que el filtrado
+// lineal nunca mezcla celdas vecinas.
+void init_glow_atlas() {
+    float half = (GLOW_ATLAS_CELL - 1) * 0.5f;
+    for (int t = 0; t < 4; t++) {
+        float radius = 0.0f, peak = 0.0f;
+        for (int k = 0; k < glow_layers_by_type[t]; k++) {
+            if (glow_layer_radius[t][k] > radius) radius = glow_layer_radius[t][k];
+            peak += glow_layer_alpha[t][k];
+        }
+        glow_sprite_radius[t] = radius;
+        glow_sprite_alpha[t] = peak;
+        glow_sprite_u0[t] = (t * GLOW_ATLAS_CELL + 0.5f) / GLOW_ATLAS_WIDTH;
+        glow_sprite_u1[t] = ((t + 1) * GLOW_ATLAS_CELL - 0.5f) / GLOW_ATLAS_WIDTH;
+        
+        for (int j = 0; j < GLOW_ATLAS_CELL; j++) {
+            for (int i = 0; i < GLOW_ATLAS_CELL; i++) {
+                float dx = (i - half) / half, dy = (j - half) / half;
+                float dist = sqrtf(dx * dx + dy * dy) * radius;  // En unidades de size
+                float a = 0.0f;
+                for (int k = 0; k < glow_layers_by_type[t]; k++) {
+                    if (dist < glow_layer_radius[t][k]) {
+                        a += glow_layer_alpha[t][k] * (1.0f - dist / glow_layer_radius[t][k]);
+                    }
+                }
+                glow_atlas[j][t * GLOW_ATLAS_CELL + i] = (unsigned char)(a / peak * 255.0f + 0.5f);
+            }
+        }
+    }
+    glow_sprite_v0 = 0.5f / GLOW_ATLAS_CELL;
+    glow_sprite_v1 = (GLOW_ATLAS_CELL - 0.5f) / GLOW_ATLAS_CELL;
+}
+
+RenderBatch render_batch;
+
+// Conteos por tipo y cursores de inicio de cada thread (generación paralela)
+int* thread_type_counts = NULL;
+BatchCursor* thread_cursors = NULL;
+int thread_slots = 0;
+
+// Índices de estrellas agrupados por tipo dentro del bloque de cada thread
+int* star_order = NULL;
+int star_order_capacity = 0;
+
+// Garantiza capacidad para el frame actual (crece por duplicación)
+int reserve_vertex_buffer(VertexBuffer* buf, int vertices) {
+    if (vertices > buf->vertex_capacity) {
+        int new_capacity = buf->vertex_capacity > 0 ? buf->vertex_capacity : 1024;
+        while (new_capacity < vertices) new_capacity *= 2;
+        Vertex* new_vertices = (Vertex*)realloc(buf->vertices, (size_t)new_capacity * sizeof(Vertex));
+        if (!new_vertices) return 0;
+        buf->vertices = new_vertices;
+        buf->vertex_capacity = new_capacity;
+    }
+    buf->vertex_count = vertices;
+    return 1;
+}
+
+int reserve_sprite_buffer(SpriteBuffer* buf, int vertices) {
+    if (vertices > buf->vertex_capacity) {
+        int new_capacity = buf->vertex_capacity > 0 ? buf->vertex_capacity : 1024;
+        while (new_capacity < vertices) new_capacity *= 2;
+        SpriteVertex* new_vertices = (SpriteVertex*)realloc(buf->vertices, (size_t)new_capacity * sizeof(SpriteVertex));
+        if (!new_vertices) return 0;
+        buf->vertices = new_vertices;
+        buf->vertex_capacity = new_capacity;
+    }
+    buf->vertex_count = vertices;
+    return 1;
+}
+
+void free_render_batch(RenderBatch* batch) {
+    free(thread_type_counts);
+    free(thread_cursors);
+    thread_type_counts = NULL;
+    thread_cursors = NULL;
+    thread_slots = 0;
+    free(star_order);
+    star_order = NULL;
+    star_order_capacity = 0;
+    free(batch->glow.vertices);
+    free(batch->lines.vertices);
+    for (int k = 0; k < 3; k++) free(batch->points[k].vertices);
+    memset(batch, 0, sizeof(RenderBatch));
+}
+
+// Avanza el cursor lo que ocupa la geometría de type_counts estrellas
+void advance_batch_cursor(BatchCursor* cursor, const int type_counts[4]) {
+    for (int t = 0; t < 4; t++) {
+        cursor->glow += type_counts[t] * GLOW_QUAD_VERTICES;
+        cursor->line += type_counts[t] * line_vertices_by_type[t];
+        if (t < 3) cursor->point[t] += type_counts[t];
+    }
+}
+
+// Dimensiona el lote a partir de cuántas estrellas hay de cada tipo
+int prepare_render_batch(RenderBatch* batch, const int type_counts[4]) {
+    BatchCursor total = { 0 };
+    advance_batch_cursor(&total, type_counts);
+    
+    if (!reserve_sprite_buffer(&batch->glow, total.glow)) return 0;
+    if (!reserve_vertex_buffer(&batch->lines, total.line)) return 0;
+    for (int k = 0; k < 3; k++) {
+        if (!reserve_vertex_buffer(&batch->points[k], total.point[k])) return 0;
+    }
+    return 1;
+}
+
+int reserve_star_order(int stars) {
+    if (stars <= star_order_capacity) return 1;
+    int capacity = star_order_capacity > 0 ? star_order_capacity : 1024;
+    while (capacity < stars) capacity *= 2;
+    int* order = (int*)realloc(star_order, (size_t)capacity * sizeof(int));
+    if (!order) return 0;
+    star_order = order;
+    star_order_capacity = capacity;
+    return 1;
+}
+
+int reserve_thread_slots(int threads) {
+    if (threads <= thread_slots) return 1;
+    int* new_counts = (int*)realloc(thread_type_counts, (size_t)threads * 4 * sizeof(int));
+    if (!new_counts) return 0;
+    thread_type_counts = new_counts;
+    BatchCursor* new_cursors = (BatchCursor*)realloc(thread_cursors, (size_t)threads * sizeof(BatchCursor));
+    if (!new_cursors) return 0;
+    thread_cursors = new_cursors;
+    thread_slots = threads;
+    return 1;
+}
+
+static inline void set_vertex(Vertex* v, float x, float y, float r, float g, float b, float a) {
+    v->x = x;
+    v->y = y;
+    v->r = r;
+    v->g = g;
+    v->b = b;
+    v->a = a;
+}
+
+static inline void emit_line(BatchCursor* cursor, float x0, float y0, float x1, float y1,
+                             float r, float g, float b) {
+    Vertex* v = &render_batch.lines.vertices[cursor->line];
+    set_vertex(&v[0], x0, y0, r, g, b, 1.0f);
+    set_vertex(&v[1], x1, y1, r, g, b, 1.0f);
+    cursor->line += 2;
+}
+
+static inline void emit_point(BatchCursor* cursor, int bucket, float x, float y, float r, float g, float b) {
+    set_vertex(&render_batch.points[bucket].vertices[cursor->point[bucket]++], x, y, r, g, b, 1.0f);
+}
+
+static inline void set_sprite_vertex(SpriteVertex* v, float x, float y, float u, float tv,
+                                     float r, float g, float b, float a) {
+    v->x = x;
+    v->y = y;
+    v->u = u;
+    v->v = tv;
+    v->r = r;
+    v->g = g;
+    v->b = b;
+    v->a = a;
+}
+
+// Función para dibujar estrella con efecto de brillo: un quad con la celda
+// del atlas de su tipo, que ya trae todas sus capas (centro opaco, borde
+// transparente). El alpha del vértice escala el perfil con GL_MODULATE.
+void draw_star_glow(BatchCursor* cursor, int type, float x, float y, float size,
+                    float r, float g, float b, float intensity) {
+    SpriteVertex* v = &render_batch.glow.vertices[cursor->glow];
+    float radius = size * glow_sprite_radius[type];
+    float alpha = intensity * glow_sprite_alpha[type];
+    float u0 = glow_sprite_u0[type], u1 = glow_sprite_u1[type];
+    
+    set_sprite_vertex(&v[0], x - radius, y - radius, u0, glow_sprite_v0, r, g, b, alpha);
+    set_sprite_vertex(&v[1], x + radius, y - radius, u1, glow_sprite_v0, r, g, b, alpha);
+    set_sprite_vertex(&v[2], x + radius, y + radius, u1, glow_sprite_v1, r, g, b, alpha);
+    set_sprite_vertex(&v[3], x - radius, y + radius, u0, glow_sprite_v1, r, g, b, alpha);
+    cursor->glow += GLOW_QUAD_VERTICES;
+}
+
+// Función para generar la geometría de los diferentes tipos de estrellas
+void render_star(const StarSystem* sys, int index, float alpha, BatchCursor* cursor) {
+    // Un solo par seno/coseno de la fase por estrella; el resto sale de tablas
+    float phase_sin = sinf(sys->pulse_phase[index]);
+    float phase_cos = cosf(sys->pulse_phase[index]);
+    float current_brightness = sys->brightness[index] * (0.7f + 0.3f * phase_sin);
+    float r = sys->r[index] * current_brightness;
+    float g = sys->g[index] * current_brightness;
+    float b = sys->b[index] * current_brightness;
+    
+    // Posición interpolada entre los dos últimos pasos de física
+    float x = sys->prev_x[index] + (sys->x[index] - sys->prev_x[index]) * alpha;
+    float y = sys->prev_y[index] + (sys->y[index] - sys->prev_y[index]) * alpha;
+    float size = sys->size[index];
+    
+    switch(sys->star_type[index]) {
+        case 0: // Estrella cruz simple con brillo
+            // Efecto de brillo externo (dos capas en el atlas)
+            draw_star_glow(cursor, 0, x, y, size, r, g, b, sys->glow_intensity[index]);
+            
+            // Cruz principal
+            emit_line(cursor, x - size, y, x + size, y, r, g, b);
+            emit_line(cursor, x, y - size, x, y + size, r, g, b);
+            
+            // Centro brillante
+            emit_point(cursor, 0, x, y, r * 1.2f, g * 1.2f, b * 1.2f);
+            break;
+            
+        case 1: // Estrella de 6 puntas
+            // Efecto de brillo
+            draw_star_glow(cursor, 1, x, y, size, r, g, b, sys->glow_intensity[index]);
+            
+            // Cruz principal
+            emit_line(cursor, x - size, y, x + size, y, r, g, b);
+            emit_line(cursor, x, y - size, x, y + size, r, g, b);
+            // Diagonales
+            float diag = size * 0.7f;
+            emit_line(cursor, x - diag, y - diag, x + diag, y + diag, r, g, b);
+            emit_line(cursor, x - diag, y + diag, x + diag, y - diag, r, g, b);
+            
+            // Centro
+            emit_point(cursor, 1, x, y, 1.0f, 1.0f, 1.0f);
+            break;
+            
+        case 2: // Círculo brillante con rayos
+            // Múltiples capas de brillo (tres en el atlas)
+            draw_star_glow(cursor, 2, x, y, size, r, g, b, sys->glow_intensity[index]);
+            
+            // Rayos
+            for (int i = 0; i < RAY_COUNT; i++) {
+                // sin(fase + i) = sin(fase)cos(i) + cos(fase)sin(i)
+                float ray_wave = phase_sin * ray_phase_cos[i] + phase_cos * ray_phase_sin[i];
+                float ray_length = size * (1.2f + 0.3f * ray_wave);
+                emit_line(cursor, x, y, x + ray_cos[i] * ray_length, y + ray_sin[i] * ray_length, r, g, b);
+            }
+            
+            // Centro súper brillante
+            emit_point(cursor, 2, x, y, 1.0f, 1.0f, 1.0f);
+            break;
+            
+        case 3: // Estrella pulsante compleja
+            // Brillo variable con múltiples capas
+            float pulse_factor = 1.0f + 0.5f * (2.0f * phase_sin * phase_cos); // sin(2 * fase)
+            draw_star_glow(cursor, 3, x, y, size * pulse_factor, r, g, b, sys->glow_intensity[index]);
+            
+            // Forma de estrella más compleja (contorno cerrado de 10 vértices)
+            float prev_x = 0.0f, prev_y = 0.0f, first_x = 0.0f, first_y = 0.0f;
+            for (int i = 0; i < SHAPE_POINTS; i++) {
+                float radius = (i % 2 == 0) ? size : size * 0.5f;
+                radius *= pulse_factor;
+                float px = x + shape_cos[i] * radius;
+                float py = y + shape_sin[i] * radius;
+                if (i == 0) {
+                    first_x = px;
+                    first_y = py;
+                } else {
+                    emit_line(cursor, prev_x, prev_y, px, py, r, g, b);
+                }
+                prev_x = px;
+                prev_y = py;
+            }
+            emit_line(cursor, prev_x, prev_y, first_x, first_y, r, g, b);
+            break;
+    }
+}
+
+// Envía un buffer con un solo draw call usando arreglos de vértices
+void submit_vertex_buffer(VertexBuffer* buf, GLenum mode) {
+    if (buf->vertex_count == 0) return;
+    glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &buf->vertices[0].x);
+    glColorPointer(4, GL_FLOAT, sizeof(Vertex), &buf->vertices[0].r);
+    glDrawArrays(mode, 0, buf->vertex_count);
+}
+
+// Sprites de brillo: quads texturizados con el atlas en un solo draw call
+void submit_sprite_buffer(SpriteBuffer* buf) {
+    if (buf->vertex_count == 0) return;
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, glow_texture);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(SpriteVertex), &buf->vertices[0].x);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(SpriteVertex), &buf->vertices[0].u);
+    glColorPointer(4, GL_FLOAT, sizeof(SpriteVertex), &buf->vertices[0].r);
+    glDrawArrays(GL_QUADS, 0, buf->vertex_count);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisable(GL_TEXTURE_2D);
+}
+
+// Dibuja el lote completo: el estado de blending se fija una vez por frame
+void submit_render_batch(RenderBatch* batch) {
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    
+    submit_sprite_buffer(&batch->glow);
+    submit_vertex_buffer(&batch->lines, GL_LINES);
+    for (int k = 0; k < 3; k++) {
+        glPointSize(3.0f + k);
+        submit_vertex_buffer(&batch->points[k], GL_POINTS);
+    }
+    
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisable(GL_BLEND);
+}
+
+// Rasterizador por software (--software-render): dibuja el mismo lote que
+// submit_render_batch en un framebuffer en memoria, sin GL. La pantalla se
+// parte en tiles de SOFT_TILE píxeles; cada primitiva (sprite de brillo,
+// línea o punto) se asigna primero a los tiles que toca su caja envolvente
+// y luego los threads rasterizan tiles completos con schedule dynamic, sin
+// compartir píxeles. El blending es aditivo como glBlendFunc(GL_SRC_ALPHA,
+// GL_ONE), con líneas y puntos suavizados como GL_LINE_SMOOTH/GL_POINT_SMOOTH.
+// --soft-output PREFIJO escribe cada frame como PREFIJO_NNNNNN.ppm (o .rgba
+// crudo, RGBA8 de arriba hacia abajo, con --soft-format raw).
+#define SOFT_TILE 32
+
+typedef struct {
+    float* color;            // RGBA en float, fila 0 abajo como en GL
+    unsigned char* pixels;   // RGBA8 del último frame, mismo orden
+    int width, height;
+    int tiles_x, tiles_y;
+    size_t* bin_cursor;      // Conteo y luego cursor por thread y tile (threads * tiles)
+    size_t* tile_start;      // Inicio de la lista de cada tile (tiles + 1)
+    uint32_t* tile_prims;    // Listas de primitivas de todos los tiles
+    size_t prim_capacity;
+    uint16_t* prim_tiles;    // Tiles que toca cada primitiva: tx0, ty0, tx1, ty1
+    int prim_slots;
+    int thread_slots;
+} SoftRaster;
+
+SoftRaster soft_raster;
+int software_render = 0;
+const char* soft_output_prefix = NULL;
+int soft_output_raw = 0;
+long long soft_frames = 0;
+
+int soft_raster_reserve(SoftRaster* sr, int primitives, int threads) {
+    if (!sr->color) {
+        sr->width = WINDOW_WIDTH;
+        sr->height = WINDOW_HEIGHT;
+        sr->tiles_x = (sr->width + SOFT_TILE - 1) / SOFT_TILE;
+        sr->tiles_y = (sr->height + SOFT_TILE - 1) / SOFT_TILE;
+        sr->color = (float*)malloc((size_t)sr->width * sr->height * 4 * sizeof(float));
+        sr->pixels = (unsigned char*)malloc((size_t)sr->width * sr->height * 4);
+        sr->tile_start = (size_t*)malloc(((size_t)sr->tiles_x * sr->tiles_y + 1) * sizeof(size_t));
+        if (!sr->color || !sr->pixels || !sr->tile_start) return 0;
+    }
+    int tiles = sr->tiles_x * sr->tiles_y;
+    if (threads > sr->thread_slots) {
+        size_t* cursor = (size_t*)realloc(sr->bin_cursor, (size_t)threads * tiles * sizeof(size_t));
+        if (!cursor) return 0;
+        sr->bin_cursor = cursor;
+        sr->thread_slots = threads;
+    }
+    if (primitives > sr->prim_slots) {
+        int slots = sr->prim_slots > 0 ? sr->prim_slots : 1024;
+        while (slots < primitives) slots *= 2;
+        uint16_t* ranges = (uint16_t*)realloc(sr->prim_tiles, (size_t)slots * 4 * sizeof(uint16_t));
+        if (!ranges) return 0;
+        sr->prim_tiles = ranges;
+        sr->prim_slots = slots;
+    }
+    return 1;
+}
+
+void free_soft_raster(SoftRaster* sr) {
+    free(sr->color);
+    free(sr->pixels);
+    free(sr->bin_cursor);
+    free(sr->tile_start);
+    free(sr->tile_prims);
+    free(sr->prim_tiles);
+    memset(sr, 0, sizeof(SoftRaster));
+}
+
+// fminf/fmaxf son llamadas a libm sin -ffast-math; aquí van en bucles internos
+static inline float soft_min(float a, float b) { return a < b ? a : b; }
+static inline float soft_max(float a, float b) { return a > b ? a : b; }
+
+// dst += src * alpha (GL_SRC_ALPHA, GL_ONE); se satura al convertir a bytes
+static inline void soft_blend(float* dst, float r, float g, float b, float a) {
+    dst[0] += r * a;
+    dst[1] += g * a;
+    dst[2] += b * a;
+    dst[3] += a * a;
+}
+
+// Sprite de brillo de draw_star_glow: quad alineado a los ejes (vértices 0
+// y 2 en esquinas opuestas) con el atlas muestreado como GL_LINEAR y el
+// alpha del vértice multiplicado por el del texel (GL_MODULATE)
+static void soft_glow_sprite(SoftRaster* sr, const SpriteVertex* quad, int px0, int py0, int px1, int py1) {
+    const SpriteVertex* lo = &quad[0];
+    const SpriteVertex* hi = &quad[2];
+    if (hi->x <= lo->x || hi->y <= lo->y) return;
+    
+    // Píxeles con el centro dentro del quad, como GL
+    int x0 = (int)ceilf(lo->x - 0.5f), x1 = (int)ceilf(hi->x - 0.5f);
+    int y0 = (int)ceilf(lo->y - 0.5f), y1 = (int)ceilf(hi->y - 0.5f);
+    if (x0 < px0) x0 = px0;
+    if (y0 < py0) y0 = py0;
+    if (x1 > px1) x1 = px1;
+    if (y1 > py1) y1 = py1;
+    
+    // Coordenada de texel (centros en enteros) en función del píxel
+    float du = (hi->u - lo->u) * GLOW_ATLAS_WIDTH / (hi->x - lo->x);
+    float dv = (hi->v - lo->v) * GLOW_ATLAS_CELL / (hi->y - lo->y);
+    float u_base = lo->u * GLOW_ATLAS_WIDTH - 0.5f - lo->x * du;
+    float v_base = lo->v * GLOW_ATLAS_CELL - 0.5f - lo->y * dv;
+    float scale = lo->a * (1.0f / 255.0f);
+    
+    // El perfil es 0 fuera del círculo inscrito: cada fila se recorta a su
+    // tramo (más un texel de margen por el filtrado)
+    float cx = (lo->x + hi->x) * 0.5f, cy = (lo->y + hi->y) * 0.5f;
+    float reach = (hi->x - lo->x) * 0.5f * (1.0f + 2.0f / GLOW_ATLAS_CELL);
+    for (int y = y0; y < y1; y++) {
+        float dy = y + 0.5f - cy;
+        if (dy * dy >= reach * reach) continue;
+        float half = sqrtf(reach * reach - dy * dy);
+        int xs = (int)floorf(cx - half), xe = (int)ceilf(cx + half);
+        if (xs < x0) xs = x0;
+        if (xe > x1) xe = x1;
+        
+        float tv = soft_min(soft_max(v_base + (y + 0.5f) * dv, 0.0f), GLOW_ATLAS_CELL - 1.0f);
+        int j = (int)tv < GLOW_ATLAS_CELL - 1 ? (int)tv : GLOW_ATLAS_CELL - 2;
+        float fy = tv - j;
+        const unsigned char* row0 = glow_atlas[j];
+        const unsigned char* row1 = glow_atlas[j + 1];
+        float* dst = &sr->color[(size_t)y * sr->width * 4];
+        for (int x = xs; x < xe; x++) {
+            float tu = soft_min(soft_max(u_base + (x + 0.5f) * du, 0.0f), GLOW_ATLAS_WIDTH - 1.0f);
+            int i = (int)tu < GLOW_ATLAS_WIDTH - 1 ? (int)tu : GLOW_ATLAS_WIDTH - 2;
+            float fx = tu - i;
+            float top = row0[i] + (row0[i + 1] - row0[i]) * fx;
+            float bottom = row1[i] + (row1[i + 1] - row1[i]) * fx;
+            float texel = top + (bottom - top) * fy;
+            if (texel <= 0.0f) continue;
+            soft_blend(&dst[x * 4], lo->r, lo->g, lo->b, texel * scale);
+        }
+    }
+}
+
+// Línea de 1 px suavizada (estilo Wu): en cada paso del eje mayor la
+// cobertura se reparte entre los dos píxeles vecinos del eje menor
+static void soft_line(SoftRaster* sr, const Vertex* v0, const Vertex* v1, int px0, int py0, int px1, int py1) {
+    float dx = v1->x - v0->x;
+    float dy = v1->y - v0->y;
+    int steep = fabsf(dy) > fabsf(dx);
+    float major0 = steep ? v0->y : v0->x, major1 = steep ? v1->y : v1->x;
+    float minor0 = steep ? v0->x : v0->y;
+    float slope = steep ? (dy != 0.0f ? dx / dy : 0.0f) : (dx != 0.0f ? dy / dx : 0.0f);
+    if (major1 < major0) {
+        float t = major0;
+        major0 = major1;
+        major1 = t;
+        minor0 = steep ? v1->x : v1->y;
+    }
+    
+    int lo = (int)ceilf(major0 - 0.5f), hi = (int)floorf(major1 - 0.5f);
+    int clip_lo = steep ? py0 : px0, clip_hi = steep ? py1 : px1;
+    int minor_lo = steep ? px0 : py0, minor_hi = steep ? px1 : py1;
+    if (lo < clip_lo) lo = clip_lo;
+    if (hi > clip_hi - 1) hi = clip_hi - 1;
+    
+    for (int m = lo; m <= hi; m++) {
+        float minor = minor0 + (m + 0.5f - major0) * slope - 0.5f;
+        int base = (int)floorf(minor);
+        float frac = minor - base;
+        for (int k = 0; k < 2; k++) {
+            int n = base + k;
+            if (n < minor_lo || n >= minor_hi) continue;
+            int x = steep ? n : m, y = steep ? m : n;
+            soft_blend(&sr->color[((size_t)y * sr->width + x) * 4], v0->r, v0->g, v0->b,
+                       v0->a * (k ? frac : 1.0f - frac));
+        }
+    }
+}
+
+// Punto redondo suavizado de diámetro size
+static void soft_point(SoftRaster* sr, const Vertex* v, float size, int px0, int py0, int px1, int py1) {
+    float radius = size * 0.5f;
+    int x0 = (int)floorf(v->x - radius - 0.5f), x1 = (int)ceilf(v->x + radius + 0.5f);
+    int y0 = (int)floorf(v->y - radius - 0.5f), y1 = (int)ceilf(v->y + radius + 0.5f);
+    if (x0 < px0) x0 = px0;
+    if (y0 < py0) y0 = py0;
+    if (x1 > px1) x1 = px1;
+    if (y1 > py1) y1 = py1;
     
-    grid->cells = (GridCell*)calloc(grid->total_cells, sizeof(GridCell));
-    for (int i = 0; i < grid->total_cells; i++) {
-        grid->cells[i].capacity = 50; 
-        grid->cells[i].star_indices = (int*)malloc(grid->cells[i].capacity * sizeof(int));
-        grid->cells[i].count = 0;
+    for (int y = y0; y < y1; y++) {
+        float dy = y + 0.5f - v->y;
+        for (int x = x0; x < x1; x++) {
+            float dx = x + 0.5f - v->x;
+            float coverage = radius + 0.5f - sqrtf(dx * dx + dy * dy);
+            if (coverage <= 0.0f) continue;
+            if (coverage > 1.0f) coverage = 1.0f;
+            soft_blend(&sr->color[((size_t)y * sr->width + x) * 4], v->r, v->g, v->b, v->a * coverage);
+        }
     }
-    
-    return grid;
 }
 
-void destroy_spatial_grid(SpatialGrid* grid) {
-    if (!grid) return;
-    
-    for (int i = 0; i < grid->total_cells; i++) {
-        free(grid->cells[i].star_indices);
+// Numeración de primitivas: sprites, luego líneas, luego puntos por tamaño
+typedef struct {
+    int sprites, lines;
+    int point_end[3];
+} SoftPrimitives;
+
+static void soft_primitive_bounds(const RenderBatch* batch, const SoftPrimitives* prims, int p,
+                                  float* x0, float* y0, float* x1, float* y1) {
+    if (p < prims->sprites) {
+        const SpriteVertex* quad = &batch->glow.vertices[(size_t)p * GLOW_QUAD_VERTICES];
+        *x0 = quad[0].x;
+        *y0 = quad[0].y;
+        *x1 = quad[2].x;
+        *y1 = quad[2].y;
+    } else if (p < prims->sprites + prims->lines) {
+        const Vertex* v = &batch->lines.vertices[(size_t)(p - prims->sprites) * 2];
+        *x0 = soft_min(v[0].x, v[1].x) - 1.0f;
+        *x1 = soft_max(v[0].x, v[1].x) + 1.0f;
+        *y0 = soft_min(v[0].y, v[1].y) - 1.0f;
+        *y1 = soft_max(v[0].y, v[1].y) + 1.0f;
+    } else {
+        int bucket = 0, start = prims->sprites + prims->lines;
+        while (p >= prims->point_end[bucket]) start = prims->point_end[bucket++];
+        const Vertex* v = &batch->points[bucket].vertices[p - start];
+        float reach = (3.0f + bucket) * 0.5f + 1.0f;
+        *x0 = v->x - reach;
+        *x1 = v->x + reach;
+        *y0 = v->y - reach;
+        *y1 = v->y + reach;
     }
-    free(grid->cells);
-    free(grid);
 }
 
-void generate_star_color(int index) {
-    int color_type = rand() % 8;
-    switch(color_type) {
-        case 0: 
-            star_system->r[index] = 0.2f + (rand() % 30) / 100.0f; 
-            star_system->g[index] = 0.4f + (rand() % 40) / 100.0f; 
-            star_system->b[index] = 0.9f + (rand() % 10) / 100.0f; 
-            break;
-        case 1: 
-            star_system->r[index] = 0.9f + (rand() % 10) / 100.0f; 
-            star_system->g[index] = 0.2f + (rand() % 30) / 100.0f; 
-            star_system->b[index] = 0.7f + (rand() % 30) / 100.0f; 
-            break;
-        case 2: 
-            star_system->r[index] = 0.9f + (rand() % 10) / 100.0f; 
-            star_system->g[index] = 0.8f + (rand() % 20) / 100.0f; 
-            star_system->b[index] = 0.1f + (rand() % 20) / 100.0f; 
-            break;
-        case 3: 
-            star_system->r[index] = 0.1f + (rand() % 20) / 100.0f; 
-            star_system->g[index] = 0.8f + (rand() % 20) / 100.0f; 
-            star_system->b[index] = 0.3f + (rand() % 30) / 100.0f; 
-            break;
-        case 4: 
-            star_system->r[index] = 0.9f + (rand() % 10) / 100.0f; 
-            star_system->g[index] = 0.5f + (rand() % 30) / 100.0f; 
-            star_system->b[index] = 0.1f + (rand() % 20) / 100.0f; 
-            break;
-        case 5: 
-            star_system->r[index] = 0.7f + (rand() % 30) / 100.0f; 
-            star_system->g[index] = 0.2f + (rand() % 20) / 100.0f; 
-            star_system->b[index] = 0.9f + (rand() % 10) / 100.0f; 
-            break;
-        case 6: 
-            star_system->r[index] = 0.1f + (rand() % 20) / 100.0f; 
-            star_system->g[index] = 0.8f + (rand() % 20) / 100.0f; 
-            star_system->b[index] = 0.9f + (rand() % 10) / 100.0f; 
-            break;
-        default: 
-            star_system->r[index] = star_system->g[index] = star_system->b[index] = 0.9f + (rand() % 10) / 100.0f; 
-            break;
+static void soft_draw_primitive(SoftRaster* sr, const RenderBatch* batch, const SoftPrimitives* prims, int p,
+                                int px0, int py0, int px1, int py1) {
+    if (p < prims->sprites) {
+        soft_glow_sprite(sr, &batch->glow.vertices[(size_t)p * GLOW_QUAD_VERTICES], px0, py0, px1, py1);
+    } else if (p < prims->sprites + prims->lines) {
+        const Vertex* v = &batch->lines.vertices[(size_t)(p - prims->sprites) * 2];
+        soft_line(sr, &v[0], &v[1], px0, py0, px1, py1);
+    } else {
+        int bucket = 0, start = prims->sprites + prims->lines;
+        while (p >= prims->point_end[bucket]) start = prims->point_end[bucket++];
+        soft_point(sr, &batch->points[bucket].vertices[p - start], 3.0f + bucket, px0, py0, px1, py1);
     }
 }
 
-void init_star(int index) {
-    star_system->x[index] = (float)(rand() % WINDOW_WIDTH);
-    star_system->y[index] = (float)(rand() % WINDOW_HEIGHT);
-    
-    float angle = (float)(rand() % 360) * PI / 180.0f;
-    float speed = (float)(rand() % 30 + 10) / 1000.0f;
-    star_system->vx[index] = cos(angle) * speed;
-    star_system->vy[index] = sin(angle) * speed;
+// Limpia el tile, dibuja su lista de primitivas y lo pasa a RGBA8
+static void soft_raster_tile(SoftRaster* sr, const RenderBatch* batch, const SoftPrimitives* prims, int tile) {
+    int px0 = (tile % sr->tiles_x) * SOFT_TILE, py0 = (tile / sr->tiles_x) * SOFT_TILE;
+    int px1 = px0 + SOFT_TILE < sr->width ? px0 + SOFT_TILE : sr->width;
+    int py1 = py0 + SOFT_TILE < sr->height ? py0 + SOFT_TILE : sr->height;
     
-    star_system->brightness[index] = 0.6f + (float)(rand() % 40) / 100.0f;
-    star_system->pulse_phase[index] = (float)(rand() % 360) * PI / 180.0f;
-    star_system->pulse_speed[index] = (float)(rand() % 20 + 5) / 10000.0f;
-    star_system->size[index] = 2.0f + (float)(rand() % 6);
-    star_system->star_type[index] = rand() % 4;
-    star_system->glow_intensity[index] = 0.5f + (float)(rand() % 50) / 100.0f;
-    
-    generate_star_color(index);
+    for (int y = py0; y < py1; y++) {
+        float* row = &sr->color[(size_t)y * sr->width * 4];
+        for (int x = px0; x < px1; x++) {
+            row[x * 4 + 0] = 0.02f;  // Mismo color de fondo que display()
+            row[x * 4 + 1] = 0.01f;
+            row[x * 4 + 2] = 0.05f;
+            row[x * 4 + 3] = 1.0f;
+        }
+    }
+    for (size_t k = sr->tile_start[tile]; k < sr->tile_start[tile + 1]; k++) {
+        soft_draw_primitive(sr, batch, prims, (int)sr->tile_prims[k], px0, py0, px1, py1);
+    }
+    for (int y = py0; y < py1; y++) {
+        const float* src = &sr->color[((size_t)y * sr->width + px0) * 4];
+        unsigned char* dst = &sr->pixels[((size_t)y * sr->width + px0) * 4];
+        for (int k = 0; k < (px1 - px0) * 4; k++) {
+            float v = src[k] < 1.0f ? src[k] : 1.0f;
+            dst[k] = (unsigned char)(v * 255.0f + 0.5f);
+        }
+    }
 }
 
-void update_spatial_grid() {
-    #pragma omp parallel for schedule(static)
-    for (int i = 0; i < spatial_grid->total_cells; i++) {
-        spatial_grid->cells[i].count = 0;
+// Binning en paralelo (conteo por thread y tile, suma prefija, llenado sin
+// sincronización) y raster por tiles. Dentro de cada tile las primitivas
+// quedan en el orden del lote, igual que con GL.
+int soft_rasterize(const RenderBatch* batch) {
+    SoftRaster* sr = &soft_raster;
+    SoftPrimitives prims;
+    prims.sprites = batch->glow.vertex_count / GLOW_QUAD_VERTICES;
+    prims.lines = batch->lines.vertex_count / 2;
+    int total = prims.sprites + prims.lines;
+    for (int k = 0; k < 3; k++) {
+        total += batch->points[k].vertex_count;
+        prims.point_end[k] = total;
     }
+    if (!soft_raster_reserve(sr, total, omp_get_max_threads())) return 0;
     
-    // Asignar estrellas a celdas del grid
-    for (int i = 0; i < star_system->count; i++) {
-        int grid_x = (int)(star_system->x[i] / GRID_SIZE);
-        int grid_y = (int)(star_system->y[i] / GRID_SIZE);
-
-        grid_x = (grid_x < 0) ? 0 : ((grid_x >= spatial_grid->width) ? spatial_grid->width - 1 : grid_x);
-        grid_y = (grid_y < 0) ? 0 : ((grid_y >= spatial_grid->height) ? spatial_grid->height - 1 : grid_y);
+    int tiles = sr->tiles_x * sr->tiles_y;
+    int ok = 1;
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+        int begin = (int)((long long)total * tid / nthreads);
+        int end = (int)((long long)total * (tid + 1) / nthreads);
+        size_t* cursor = &sr->bin_cursor[(size_t)tid * tiles];
+        memset(cursor, 0, (size_t)tiles * sizeof(size_t));
+        
+        for (int p = begin; p < end; p++) {
+            float x0, y0, x1, y1;
+            soft_primitive_bounds(batch, &prims, p, &x0, &y0, &x1, &y1);
+            uint16_t* range = &sr->prim_tiles[(size_t)p * 4];
+            int tx0 = (int)floorf(x0) / SOFT_TILE, tx1 = (int)floorf(x1) / SOFT_TILE;
+            int ty0 = (int)floorf(y0) / SOFT_TILE, ty1 = (int)floorf(y1) / SOFT_TILE;
+            if (x1 < 0.0f || y1 < 0.0f || tx0 >= sr->tiles_x || ty0 >= sr->tiles_y) {
+                range[0] = 1;  // Fuera de pantalla: rango vacío
+                range[1] = range[2] = range[3] = 0;
+                continue;
+            }
+            if (x0 < 0.0f) tx0 = 0;
+            if (y0 < 0.0f) ty0 = 0;
+            if (tx1 >= sr->tiles_x) tx1 = sr->tiles_x - 1;
+            if (ty1 >= sr->tiles_y) ty1 = sr->tiles_y - 1;
+            range[0] = (uint16_t)tx0;
+            range[1] = (uint16_t)ty0;
+            range[2] = (uint16_t)tx1;
+            range[3] = (uint16_t)ty1;
+            for (int ty = ty0; ty <= ty1; ty++) {
+                for (int tx = tx0; tx <= tx1; tx++) cursor[ty * sr->tiles_x + tx]++;
+            }
+        }
         
-        int cell_index = grid_y * spatial_grid->width + grid_x;
-        star_system->grid_cell[i] = cell_index;
-        #pragma omp critical
+        #pragma omp barrier
+        #pragma omp single
         {
-            if (spatial_grid->cells[cell_index].count < spatial_grid->cells[cell_index].capacity) {
-                spatial_grid->cells[cell_index].star_indices[spatial_grid->cells[cell_index].count] = i;
-                spatial_grid->cells[cell_index].count++;
+            size_t offset = 0;
+            for (int t = 0; t < tiles; t++) {
+                sr->tile_start[t] = offset;
+                for (int k = 0; k < nthreads; k++) {
+                    size_t count = sr->bin_cursor[(size_t)k * tiles + t];
+                    sr->bin_cursor[(size_t)k * tiles + t] = offset;
+                    offset += count;
+                }
+            }
+            sr->tile_start[tiles] = offset;
+            if (offset > sr->prim_capacity) {
+                size_t capacity = sr->prim_capacity > 0 ? sr->prim_capacity : 4096;
+                while (capacity < offset) capacity *= 2;
+                uint32_t* list = (uint32_t*)realloc(sr->tile_prims, capacity * sizeof(uint32_t));
+                if (list) {
+                    sr->tile_prims = list;
+                    sr->prim_capacity = capacity;
+                } else {
+                    ok = 0;
+                }
+            }
+        }
+        
+        if (ok) {
+            for (int p = begin; p < end; p++) {
+                const uint16_t* range = &sr->prim_tiles[(size_t)p * 4];
+                for (int ty = range[1]; ty <= range[3]; ty++) {
+                    for (int tx = range[0]; tx <= range[2]; tx++) {
+                        sr->tile_prims[cursor[ty * sr->tiles_x + tx]++] = (uint32_t)p;
+                    }
+                }
+            }
+            #pragma omp barrier
+            #pragma omp for schedule(dynamic)
+            for (int t = 0; t < tiles; t++) {
+                soft_raster_tile(sr, batch, &prims, t);
             }
         }
     }
+    return ok;
 }
 
-void apply_physics_optimized() {
-    const float damping = 0.98f;
-    const float force_constant = 0.000005f;
-    const float center_x = WINDOW_WIDTH / 2.0f;
-    const float center_y = WINDOW_HEIGHT / 2.0f;
-    const float two_pi = 2.0f * PI;
-    const float window_width_f = (float)WINDOW_WIDTH;
-    const float window_height_f = (float)WINDOW_HEIGHT;
-
-    #pragma omp parallel for simd schedule(guided)
-    for (int i = 0; i < star_system->count; i++) {
-        star_system->x[i] += star_system->vx[i];
-        star_system->y[i] += star_system->vy[i];
-        float size = star_system->size[i];
-        
-        if (star_system->x[i] <= size || star_system->x[i] >= window_width_f - size) {
-            star_system->vx[i] *= -damping;
-            star_system->x[i] = (star_system->x[i] <= size) ? size : window_width_f - size;
-        }
-        
-        if (star_system->y[i] <= size || star_system->y[i] >= window_height_f - size) {
-            star_system->vy[i] *= -damping;
-            star_system->y[i] = (star_system->y[i] <= size) ? size : window_height_f - size;
+// PPM binario (P6) o RGBA8 crudo, de arriba hacia abajo
+int write_soft_frame(const char* path) {
+    SoftRaster* sr = &soft_raster;
+    FILE* out = fopen(path, "wb");
+    if (!out) {
+        printf("Error: No se pudo escribir el frame %s\n", path);
+        return 0;
+    }
+    
+    int ok = 1;
+    unsigned char* row = (unsigned char*)malloc((size_t)sr->width * 3);
+    if (!soft_output_raw) {
+        ok = row && fprintf(out, "P6\n%d %d\n255\n", sr->width, sr->height) > 0;
+    }
+    for (int y = sr->height - 1; ok && y >= 0; y--) {
+        const unsigned char* src = &sr->pixels[(size_t)y * sr->width * 4];
+        if (soft_output_raw) {
+            ok = fwrite(src, 4, sr->width, out) == (size_t)sr->width;
+        } else {
+            for (int x = 0; x < sr->width; x++) {
+                row[x * 3 + 0] = src[x * 4 + 0];
+                row[x * 3 + 1] = src[x * 4 + 1];
+                row[x * 3 + 2] = src[x * 4 + 2];
+            }
+            ok = fwrite(row, 3, sr->width, out) == (size_t)sr->width;
         }
-        
-        star_system->pulse_phase[i] += star_system->pulse_speed[i];
-        if (star_system->pulse_phase[i] > two_pi) {
-            star_system->pulse_phase[i] -= two_pi;
+    }
+    free(row);
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) printf("Error: No se pudo escribir el frame %s\n", path);
+    return ok;
+}
+
+// Muestra (en ventana) y/o guarda el frame rasterizado
+void present_soft_frame() {
+    if (soft_output_prefix) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s_%06lld.%s", soft_output_prefix, soft_frames,
+                 soft_output_raw ? "rgba" : "ppm");
+        write_soft_frame(path);
+    }
+    soft_frames++;
+    
+    if (!headless_mode) {
+        glRasterPos2i(0, 0);
+        glDrawPixels(soft_raster.width, soft_raster.height, GL_RGBA, GL_UNSIGNED_BYTE, soft_raster.pixels);
+    }
+}
+
+// Render instanciado en GPU (--instanced): las columnas del SoA se suben tal
+// cual como atributos por instancia (divisor 1), una copia por columna, y un
+// vertex shader arma la geometría de cada estrella: interpolación, pulso de
+// brillo, expansión del quad de brillo y de las líneas según star_type. Las
+// columnas no están ordenadas por tipo, así que en vez de un draw por tipo
+// se hace uno por primitiva (brillo, líneas, puntos) para todas las
+// estrellas y el shader elige la forma con el atributo star_type; los
+// vértices que el tipo no usa se mandan fuera del volumen de recorte. El
+// fragmento sigue siendo de función fija (textura del atlas con
+// GL_MODULATE, GL_POINT_SMOOTH/GL_LINE_SMOOTH), igual que el lote de CPU.
+// Necesita GL 3.3 o GL 2.0 con ARB_instanced_arrays y ARB_draw_instanced
+// (llvmpipe de Mesa alcanza).
+#define INSTANCE_COLUMNS 12
+#define LINE_TEMPLATE_VERTICES 20      // Máximo de line_vertices_by_type
+#define TEMPLATE_GLOW_FIRST 0          // Plantilla: 4 esquinas del quad de brillo,
+#define TEMPLATE_LINE_FIRST 4          // 20 números de vértice de línea
+#define TEMPLATE_POINT_FIRST 24        // y el punto central
+#define TEMPLATE_VERTICES 25
+
+int instanced_render = 0;
+
+// Puntos de entrada posteriores a GL 1.1 (opengl32 de Windows no los
+// exporta): se cargan en tiempo de ejecución
+PFNGLCREATESHADERPROC p_glCreateShader;
+PFNGLSHADERSOURCEPROC p_glShaderSource;
+PFNGLCOMPILESHADERPROC p_glCompileShader;
+PFNGLGETSHADERIVPROC p_glGetShaderiv;
+PFNGLGETSHADERINFOLOGPROC p_glGetShaderInfoLog;
+PFNGLCREATEPROGRAMPROC p_glCreateProgram;
+PFNGLATTACHSHADERPROC p_glAttachShader;
+PFNGLBINDATTRIBLOCATIONPROC p_glBindAttribLocation;
+PFNGLLINKPROGRAMPROC p_glLinkProgram;
+PFNGLGETPROGRAMIVPROC p_glGetProgramiv;
+PFNGLGETPROGRAMINFOLOGPROC p_glGetProgramInfoLog;
+PFNGLUSEPROGRAMPROC p_glUseProgram;
+PFNGLGETUNIFORMLOCATIONPROC p_glGetUniformLocation;
+PFNGLUNIFORM1IPROC p_glUniform1i;
+PFNGLUNIFORM1FPROC p_glUniform1f;
+PFNGLUNIFORM2FPROC p_glUniform2f;
+PFNGLUNIFORM4FVPROC p_glUniform4fv;
+PFNGLGENBUFFERSPROC p_glGenBuffers;
+PFNGLBINDBUFFERPROC p_glBindBuffer;
+PFNGLBUFFERDATAPROC p_glBufferData;
+PFNGLBUFFERSUBDATAPROC p_glBufferSubData;
+PFNGLVERTEXATTRIBPOINTERPROC p_glVertexAttribPointer;
+PFNGLENABLEVERTEXATTRIBARRAYPROC p_glEnableVertexAttribArray;
+PFNGLDISABLEVERTEXATTRIBARRAYPROC p_glDisableVertexAttribArray;
+PFNGLVERTEXATTRIBDIVISORPROC p_glVertexAttribDivisor;
+PFNGLDRAWARRAYSINSTANCEDPROC p_glDrawArraysInstanced;
+
+GLuint instanced_program = 0;
+GLuint template_buffer = 0;
+GLuint instance_buffer = 0;
+GLint uniform_pass = -1, uniform_alpha = -1;
+
+// Atributo 0 = plantilla; 1..INSTANCE_COLUMNS = columnas, en este orden
+static const char* instance_attributes[INSTANCE_COLUMNS] = {
+    "a_x", "a_y", "a_prev_x", "a_prev_y", "a_size", "a_r", "a_g", "a_b",
+    "a_brightness", "a_phase", "a_glow", "a_type"
+};
+
+static const char* instanced_vertex_shader =
+    "#version 120\n"
+    "attribute vec2 a_corner;\n"  // Esquina del quad (brillo) o número de vértice (líneas)
+    "attribute float a_x, a_y, a_prev_x, a_prev_y, a_size, a_r, a_g, a_b;\n"
+    "attribute float a_brightness, a_phase, a_glow, a_type;\n"
+    "uniform int u_pass;\n"  // 0 brillo, 1 líneas, 2 puntos
+    "uniform float u_alpha;\n"
+    "uniform vec4 u_glow[4];\n"  // Radio en unidades de size, alpha pico, u0, u1
+    "uniform vec2 u_glow_v;\n"
+    "uniform vec4 u_lines[4 * 20];\n"  // Desplazamiento, rayo (índice + 1), w: 1 pulso, -1 sin usar
+    "void main() {\n"
+    "    int type = int(a_type);\n"
+    "    float phase_sin = sin(a_phase);\n"
+    "    vec3 color = vec3(a_r, a_g, a_b) * (a_brightness * (0.7 + 0.3 * phase_sin));\n"
+    "    float pulse = type == 3 ? 1.0 + 0.5 * sin(2.0 * a_phase) : 1.0;\n"
+    "    vec2 pos = vec2(a_prev_x + (a_x - a_prev_x) * u_alpha, a_prev_y + (a_y - a_prev_y) * u_alpha);\n"
+    "    vec4 c = vec4(color, 1.0);\n"
+    "    if (u_pass == 0) {\n"
+    "        vec4 glow = u_glow[type];\n"
+    "        vec2 t = a_corner * 0.5 + 0.5;\n"
+    "        pos += a_corner * (a_size * pulse * glow.x);\n"
+    "        c.a = a_glow * glow.y;\n"
+    "        gl_TexCoord[0] = vec4(mix(glow.z, glow.w, t.x), mix(u_glow_v.x, u_glow_v.y, t.y), 0.0, 1.0);\n"
+    "    } else if (u_pass == 1) {\n"
+    "        vec4 v = u_lines[type * 20 + int(a_corner.x)];\n"
+    "        if (v.w < 0.0) { gl_Position = vec4(2.0, 2.0, 2.0, 1.0); return; }\n"
+    "        float scale = a_size;\n"
+    "        if (v.z > 0.0) scale *= 1.2 + 0.3 * sin(a_phase + v.z - 1.0);\n"
+    "        if (v.w > 0.0) scale *= pulse;\n"
+    "        pos += v.xy * scale;\n"
+    "    } else {\n"
+    "        if (type == 3) { gl_Position = vec4(2.0, 2.0, 2.0, 1.0); return; }\n"
+    "        gl_PointSize = 3.0 + float(type);\n"
+    "        c.rgb = type == 0 ? color * 1.2 : vec3(1.0);\n"
+    "    }\n"
+    "    gl_FrontColor = c;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(pos, 0.0, 1.0);\n"
+    "}\n";
+
+// Plantilla de líneas de cada tipo con las mismas tablas que render_star
+static void build_line_template(float lines[4 * LINE_TEMPLATE_VERTICES][4]) {
+    static const float cross[8][2] = {
+        { -1.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0f, -1.0f }, { 0.0f, 1.0f },
+        { -0.7f, -0.7f }, { 0.7f, 0.7f }, { -0.7f, 0.7f }, { 0.7f, -0.7f }
+    };
+    for (int k = 0; k < 4 * LINE_TEMPLATE_VERTICES; k++) {
+        lines[k][0] = lines[k][1] = lines[k][2] = 0.0f;
+        lines[k][3] = -1.0f;
+    }
+    for (int t = 0; t < 2; t++) {
+        for (int k = 0; k < line_vertices_by_type[t]; k++) {
+            float* v = lines[t * LINE_TEMPLATE_VERTICES + k];
+            v[0] = cross[k][0];
+            v[1] = cross[k][1];
+            v[3] = 0.0f;
         }
-        
-        float dist_x = center_x - star_system->x[i];
-        float dist_y = center_y - star_system->y[i];
-        float distance = sqrtf(dist_x * dist_x + dist_y * dist_y);
-        
-        if (distance > 0.0f) {
-            float inv_distance = 1.0f / distance;
-            star_system->vx[i] += (dist_x * inv_distance) * force_constant;
-            star_system->vy[i] += (dist_y * inv_distance) * force_constant;
+    }
+    for (int i = 0; i < RAY_COUNT; i++) {
+        float* center = lines[2 * LINE_TEMPLATE_VERTICES + 2 * i];
+        float* tip = lines[2 * LINE_TEMPLATE_VERTICES + 2 * i + 1];
+        center[3] = 0.0f;
+        tip[0] = ray_cos[i];
+        tip[1] = ray_sin[i];
+        tip[2] = (float)(i + 1);
+        tip[3] = 0.0f;
+    }
+    for (int i = 0; i < SHAPE_POINTS; i++) {
+        for (int end = 0; end < 2; end++) {
+            int p = (i + end) % SHAPE_POINTS;
+            float radius = (p % 2 == 0) ? 1.0f : 0.5f;
+            float* v = lines[3 * LINE_TEMPLATE_VERTICES + 2 * i + end];
+            v[0] = shape_cos[p] * radius;
+            v[1] = shape_sin[p] * radius;
+            v[3] = 1.0f;
         }
     }
 }
 
-void apply_star_interactions() {
-    const float interaction_radius = 50.0f;
-    const float interaction_strength = 0.000001f;
+static GLuint compile_instanced_program() {
+    GLuint shader = p_glCreateShader(GL_VERTEX_SHADER);
+    p_glShaderSource(shader, 1, &instanced_vertex_shader, NULL);
+    p_glCompileShader(shader);
+    GLint ok = 0;
+    char log[1024];
+    p_glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        p_glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        printf("Error: No compiló el vertex shader instanciado:\n%s\n", log);
+        return 0;
+    }
     
-    #pragma omp parallel for schedule(dynamic) collapse(2)
-    for (int gy = 0; gy < spatial_grid->height; gy++) {
-        for (int gx = 0; gx < spatial_grid->width; gx++) {
-            int cell_index = gy * spatial_grid->width + gx;
-            GridCell* current_cell = &spatial_grid->cells[cell_index];
-            for (int i = 0; i < current_cell->count; i++) {
-                int star_a = current_cell->star_indices[i];
-                
-                for (int j = i + 1; j < current_cell->count; j++) {
-                    int star_b = current_cell->star_indices[j];
-                    
-                    float dx = star_system->x[star_a] - star_system->x[star_b];
-                    float dy = star_system->y[star_a] - star_system->y[star_b];
-                    float distance_sq = dx * dx + dy * dy;
-                    
-                    if (distance_sq < interaction_radius * interaction_radius && distance_sq > 0.1f) {
-                        float distance = sqrtf(distance_sq);
-                        float inv_distance = 1.0f / distance;
-                        float force = interaction_strength * inv_distance;
-                        
-                        // Aplicar fuerzas mutuamente
-                        star_system->vx[star_a] += dx * force;
-                        star_system->vy[star_a] += dy * force;
-                        star_system->vx[star_b] -= dx * force;
-                        star_system->vy[star_b] -= dy * force;
-                    }
-                }
-                
-                // Interacciones con celdas vecinas (solo derecha y abajo para evitar duplicados)
-                for (int nx = 0; nx <= 1; nx++) {
-                    for (int ny = 0; ny <= 1; ny++) {
-                        if (nx == 0 && ny == 0) continue; // Misma celda ya procesada
-                        
-                        int neighbor_gx = gx + nx;
-                        int neighbor_gy = gy + ny;
-                        
-                        if (neighbor_gx < spatial_grid->width && neighbor_gy < spatial_grid->height) {
-                            int neighbor_index = neighbor_gy * spatial_grid->width + neighbor_gx;
-                            GridCell* neighbor_cell = &spatial_grid->cells[neighbor_index];
-                            
-                            for (int k = 0; k < neighbor_cell->count; k++) {
-                                int star_b = neighbor_cell->star_indices[k];
-                                
-                                float dx = star_system->x[star_a] - star_system->x[star_b];
-                                float dy = star_system->y[star_a] - star_system->y[star_b];
-                                float distance_sq = dx * dx + dy * dy;
-                                
-                                if (distance_sq < interaction_radius * interaction_radius && distance_sq > 0.1f) {
-                                    float distance = sqrtf(distance_sq);
-                                    float inv_distance = 1.0f / distance;
-                                    float force = interaction_strength * inv_distance;
-                                    
-                                    star_system->vx[star_a] += dx * force;
-                                    star_system->vy[star_a] += dy * force;
-                                    star_system->vx[star_b] -= dx * force;
-                                    star_system->vy[star_b] -= dy * force;
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
+    GLuint program = p_glCreateProgram();
+    p_glAttachShader(program, shader);
+    p_glBindAttribLocation(program, 0, "a_corner");
+    for (int c = 0; c < INSTANCE_COLUMNS; c++) {
+        p_glBindAttribLocation(program, c + 1, instance_attributes[c]);
     }
+    p_glLinkProgram(program);
+    p_glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        p_glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        printf("Error: No enlazó el programa instanciado:\n%s\n", log);
+        return 0;
+    }
+    return program;
 }
 
-void draw_star_glow(float x, float y, float size, float r, float g, float b, float alpha) {
-    int segments = 16;
-    glBegin(GL_TRIANGLE_FAN);
-    glColor4f(r, g, b, alpha);
-    glVertex2f(x, y);
-    for (int i = 0; i <= segments; i++) {
-        float angle = 2.0f * PI * i / segments;
-        float px = x + cos(angle) * size;
-        float py = y + sin(angle) * size;
-        glColor4f(r, g, b, 0.0f);
-        glVertex2f(px, py);
+// Carga los puntos de entrada, compila el shader y sube plantilla y
+// uniforms fijos. Devuelve 0 si el contexto no alcanza (se usa el lote).
+int init_instanced_renderer() {
+    const char* version = (const char*)glGetString(GL_VERSION);
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    int major = 0, minor = 0;
+    if (!version || sscanf(version, "%d.%d", &major, &minor) != 2) return 0;
+    int core = major > 3 || (major == 3 && minor >= 3);
+    if (major < 2 || (!core && (!extensions || !strstr(extensions, "GL_ARB_instanced_arrays") ||
+                                !strstr(extensions, "GL_ARB_draw_instanced")))) {
+        printf("Advertencia: OpenGL %s sin instancing; se usa el lote de vértices\n", version);
+        return 0;
+    }
+    
+    int ok = 1;
+#define LOAD_GL(name) ok &= (p_##name = (typeof(p_##name))glutGetProcAddress(#name)) != NULL
+#define LOAD_GL_ARB(name) ok &= (p_##name = (typeof(p_##name))glutGetProcAddress(core ? #name : #name "ARB")) != NULL
+    LOAD_GL(glCreateShader);
+    LOAD_GL(glShaderSource);
+    LOAD_GL(glCompileShader);
+    LOAD_GL(glGetShaderiv);
+    LOAD_GL(glGetShaderInfoLog);
+    LOAD_GL(glCreateProgram);
+    LOAD_GL(glAttachShader);
+    LOAD_GL(glBindAttribLocation);
+    LOAD_GL(glLinkProgram);
+    LOAD_GL(glGetProgramiv);
+    LOAD_GL(glGetProgramInfoLog);
+    LOAD_GL(glUseProgram);
+    LOAD_GL(glGetUniformLocation);
+    LOAD_GL(glUniform1i);
+    LOAD_GL(glUniform1f);
+    LOAD_GL(glUniform2f);
+    LOAD_GL(glUniform4fv);
+    LOAD_GL(glGenBuffers);
+    LOAD_GL(glBindBuffer);
+    LOAD_GL(glBufferData);
+    LOAD_GL(glBufferSubData);
+    LOAD_GL(glVertexAttribPointer);
+    LOAD_GL(glEnableVertexAttribArray);
+    LOAD_GL(glDisableVertexAttribArray);
+    LOAD_GL_ARB(glVertexAttribDivisor);
+    LOAD_GL_ARB(glDrawArraysInstanced);
+#undef LOAD_GL
+#undef LOAD_GL_ARB
+    if (!ok) {
+        printf("Advertencia: Faltan funciones de OpenGL para instancing; se usa el lote de vértices\n");
+        return 0;
+    }
+    
+    instanced_program = compile_instanced_program();
+    if (!instanced_program) return 0;
+    
+    float corners[TEMPLATE_VERTICES][2] = {
+        { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f }
+    };
+    for (int k = 0; k < LINE_TEMPLATE_VERTICES; k++) {
+        corners[TEMPLATE_LINE_FIRST + k][0] = (float)k;
+    }
+    p_glGenBuffers(1, &template_buffer);
+    p_glBindBuffer(GL_ARRAY_BUFFER, template_buffer);
+    p_glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    p_glGenBuffers(1, &instance_buffer);
+    p_glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    float glow[4][4];
+    for (int t = 0; t < 4; t++) {
+        glow[t][0] = glow_sprite_radius[t];
+        glow[t][1] = glow_sprite_alpha[t];
+        glow[t][2] = glow_sprite_u0[t];
+        glow[t][3] = glow_sprite_u1[t];
     }
-    glEnd();
+    float lines[4 * LINE_TEMPLATE_VERTICES][4];
+    build_line_template(lines);
+    
+    p_glUseProgram(instanced_program);
+    p_glUniform4fv(p_glGetUniformLocation(instanced_program, "u_glow"), 4, &glow[0][0]);
+    p_glUniform2f(p_glGetUniformLocation(instanced_program, "u_glow_v"), glow_sprite_v0, glow_sprite_v1);
+    p_glUniform4fv(p_glGetUniformLocation(instanced_program, "u_lines"), 4 * LINE_TEMPLATE_VERTICES, &lines[0][0]);
+    uniform_pass = p_glGetUniformLocation(instanced_program, "u_pass");
+    uniform_alpha = p_glGetUniformLocation(instanced_program, "u_alpha");
+    p_glUseProgram(0);
+    return 1;
 }
 
-void render_star(int index) {
-    float current_brightness = star_system->brightness[index] * 
-                              (0.7f + 0.3f * sinf(star_system->pulse_phase[index]));
-    float r = star_system->r[index] * current_brightness;
-    float g = star_system->g[index] * current_brightness;
-    float b = star_system->b[index] * current_brightness;
-    float x = star_system->x[index];
-    float y = star_system->y[index];
-    float size = star_system->size[index];
+// Sube las columnas (una copia cada una) y dibuja brillo, líneas y puntos
+// con un draw instanciado cada uno
+void submit_instanced(const StarSystem* sys, float alpha) {
+    int n = sys->count;
+    const void* columns[INSTANCE_COLUMNS] = {
+        sys->x, sys->y, sys->prev_x, sys->prev_y, sys->size, sys->r, sys->g, sys->b,
+        sys->brightness, sys->pulse_phase, sys->glow_intensity, sys->star_type
+    };
+    size_t column_bytes = (size_t)n * sizeof(float);
+    
+    p_glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    p_glBufferData(GL_ARRAY_BUFFER, column_bytes * INSTANCE_COLUMNS, NULL, GL_STREAM_DRAW);  // Huérfano: sin esperar a la GPU
+    for (int c = 0; c < INSTANCE_COLUMNS; c++) {
+        p_glBufferSubData(GL_ARRAY_BUFFER, column_bytes * c, column_bytes, columns[c]);
+        GLenum type = (c == INSTANCE_COLUMNS - 1) ? GL_INT : GL_FLOAT;  // star_type es int
+        p_glVertexAttribPointer(c + 1, 1, type, GL_FALSE, 0, (const void*)(column_bytes * c));
+        p_glVertexAttribDivisor(c + 1, 1);
+        p_glEnableVertexAttribArray(c + 1);
+    }
+    p_glBindBuffer(GL_ARRAY_BUFFER, template_buffer);
+    p_glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (const void*)0);
+    p_glEnableVertexAttribArray(0);
     
+    p_glUseProgram(instanced_program);
+    p_glUniform1f(uniform_alpha, alpha);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE);
     
-    switch(star_system->star_type[index]) {
-        case 0:
-            draw_star_glow(x, y, size * 3, r, g, b, 0.1f * star_system->glow_intensity[index]);
-            draw_star_glow(x, y, size * 2, r, g, b, 0.2f * star_system->glow_intensity[index]);
-            glColor3f(r, g, b);
-            glBegin(GL_LINES);
-            glVertex2f(x - size, y); glVertex2f(x + size, y);
-            glVertex2f(x, y - size); glVertex2f(x, y + size);
-            glEnd();
-            glPointSize(3.0f);
-            glBegin(GL_POINTS);
-            glColor3f(r * 1.2f, g * 1.2f, b * 1.2f);
-            glVertex2f(x, y);
-            glEnd();
-            break;
-            
-        case 1:
-            draw_star_glow(x, y, size * 4, r, g, b, 0.15f * star_system->glow_intensity[index]);
-            glColor3f(r, g, b);
-            glBegin(GL_LINES);
-            glVertex2f(x - size, y); glVertex2f(x + size, y);
-            glVertex2f(x, y - size); glVertex2f(x, y + size);
-            float diag = size * 0.7f;
-            glVertex2f(x - diag, y - diag); glVertex2f(x + diag, y + diag);
-            glVertex2f(x - diag, y + diag); glVertex2f(x + diag, y - diag);
-            glEnd();
-            glPointSize(4.0f);
-            glBegin(GL_POINTS);
-            glColor3f(1.0f, 1.0f, 1.0f);
-            glVertex2f(x, y);
-            glEnd();
-            break;
-            
-        case 2:
-            draw_star_glow(x, y, size * 5, r, g, b, 0.08f * star_system->glow_intensity[index]);
-            draw_star_glow(x, y, size * 3, r, g, b, 0.15f * star_system->glow_intensity[index]);
-            draw_star_glow(x, y, size * 1.5f, r, g, b, 0.3f * star_system->glow_intensity[index]);
-            glColor3f(r, g, b);
-            glBegin(GL_LINES);
-            for (int i = 0; i < 8; i++) {
-                float angle = (PI * 2 * i) / 8;
-                float ray_length = size * (1.2f + 0.3f * sinf(star_system->pulse_phase[index] + i));
-                glVertex2f(x, y);
-                glVertex2f(x + cosf(angle) * ray_length, y + sinf(angle) * ray_length);
-            }
-            glEnd();
-            glPointSize(5.0f);
-            glBegin(GL_POINTS);
-            glColor3f(1.0f, 1.0f, 1.0f);
-            glVertex2f(x, y);
-            glEnd();
-            break;
-            
-        case 3:
-            float pulse_factor = 1.0f + 0.5f * sinf(star_system->pulse_phase[index] * 2);
-            draw_star_glow(x, y, size * 6 * pulse_factor, r, g, b, 0.05f * star_system->glow_intensity[index]);
-            draw_star_glow(x, y, size * 3 * pulse_factor, r, g, b, 0.1f * star_system->glow_intensity[index]);
-            glColor3f(r, g, b);
-            glBegin(GL_LINE_LOOP);
-            for (int i = 0; i < 10; i++) {
-                float angle = (PI * 2 * i) / 10;
-                float radius = (i % 2 == 0) ? size : size * 0.5f;
-                radius *= pulse_factor;
-                glVertex2f(x + cosf(angle) * radius, y + sinf(angle) * radius);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, glow_texture);
+    p_glUniform1i(uniform_pass, 0);
+    p_glDrawArraysInstanced(GL_TRIANGLE_FAN, TEMPLATE_GLOW_FIRST, 4, n);
+    glDisable(GL_TEXTURE_2D);
+    
+    p_glUniform1i(uniform_pass, 1);
+    p_glDrawArraysInstanced(GL_LINES, TEMPLATE_LINE_FIRST, LINE_TEMPLATE_VERTICES, n);
+    
+    glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+    p_glUniform1i(uniform_pass, 2);
+    p_glDrawArraysInstanced(GL_POINTS, TEMPLATE_POINT_FIRST, 1, n);
+    glDisable(GL_VERTEX_PROGRAM_POINT_SIZE);
+    
+    glDisable(GL_BLEND);
+    p_glUseProgram(0);
+    for (int c = 0; c <= INSTANCE_COLUMNS; c++) p_glDisableVertexAttribArray(c);
+    p_glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Generación de vértices en paralelo: cada thread cuenta los tipos de su
+// bloque estático de estrellas, una suma prefija da el inicio de su porción
+// del lote y cada thread la llena sin sincronización. Dentro del bloque las
+// estrellas se recorren agrupadas por tipo (partición estable en
+// star_order), así el switch de render_star toma la misma rama en tramos
+// largos en lugar de saltar al azar entre los cuatro tipos. El estado GL
+// ya se fija una vez por buffer en submit_render_batch. Solo el envío GL
+// queda en el thread principal.
+void render_stars(const StarSystem* sys, float alpha) {
+    int n = sys->count;
+    int batch_ok = 1;
+    
+    if (instanced_render) {
+        double phase_start = omp_get_wtime();
+        submit_instanced(sys, alpha);
+        profile_end(PHASE_SUBMIT, phase_start);
+        return;
+    }
+    if (!reserve_thread_slots(omp_get_max_threads()) || !reserve_star_order(n)) return;
+    
+    double phase_start = omp_get_wtime();
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        int nthreads = omp_get_num_threads();
+        int begin = (int)((long long)n * tid / nthreads);
+        int end = (int)((long long)n * (tid + 1) / nthreads);
+        
+        double t0 = omp_get_wtime();
+        int* counts = &thread_type_counts[tid * 4];
+        counts[0] = counts[1] = counts[2] = counts[3] = 0;
+        for (int i = begin; i < end; i++) counts[sys->star_type[i]]++;
+        int offset[4] = { begin, begin + counts[0], begin + counts[0] + counts[1],
+                          begin + counts[0] + counts[1] + counts[2] };
+        for (int i = begin; i < end; i++) star_order[offset[sys->star_type[i]]++] = i;
+        double busy = trace_segment(PHASE_VERTICES, t0);
+        
+        #pragma omp barrier
+        #pragma omp single
+        {
+            int type_counts[4] = { 0, 0, 0, 0 };
+            BatchCursor cursor = { 0 };
+            for (int t = 0; t < nthreads; t++) {
+                thread_cursors[t] = cursor;
+                advance_batch_cursor(&cursor, &thread_type_counts[t * 4]);
+                for (int k = 0; k < 4; k++) type_counts[k] += thread_type_counts[t * 4 + k];
             }
-            glEnd();
-            break;
+            batch_ok = prepare_render_batch(&render_batch, type_counts);
+        }
+        
+        t0 = omp_get_wtime();
+        if (batch_ok) {
+            BatchCursor cursor = thread_cursors[tid];
+            for (int k = begin; k < end; k++) render_star(sys, star_order[k], alpha, &cursor);
+        }
+        profile_thread_add(PHASE_VERTICES, busy + trace_segment(PHASE_VERTICES, t0));
     }
-    glDisable(GL_BLEND);
+    profile_end(PHASE_VERTICES, phase_start);
+    
+    if (!batch_ok) {
+        printf("Error: No se pudo asignar memoria para el lote de vértices\n");
+        return;
+    }
+    if (software_render) {
+        phase_start = omp_get_wtime();
+        int raster_ok = soft_rasterize(&render_batch);
+        profile_end(PHASE_RASTER, phase_start);
+        if (!raster_ok) {
+            printf("Error: No se pudo asignar memoria para el rasterizador por software\n");
+            return;
+        }
+        phase_start = omp_get_wtime();
+        present_soft_frame();
+        profile_end(PHASE_SUBMIT, phase_start);
+        return;
+    }
+    // Sin contexto GL no se envía nada: headless mide solo la generación de vértices
+    if (headless_mode) return;
+    phase_start = omp_get_wtime();
+    submit_render_batch(&render_batch);
+    profile_end(PHASE_SUBMIT, phase_start);
 }
 
 void display_fps() {
     fps_counter++;
-    clock_t current_time = clock();
-    if (current_time - fps_timer >= CLOCKS_PER_SEC) {
-        fps = (float)fps_counter / ((current_time - fps_timer) / (float)CLOCKS_PER_SEC);
+    // Tiempo de pared: clock() acumula el CPU de todos los threads
+    double current_time = omp_get_wtime();
+    if (current_time - fps_timer >= 1.0) {
+        fps = (float)(fps_counter / (current_time - fps_timer));
+        float steps_per_second = (float)((sim_steps - fps_steps) / (current_time - fps_timer));
         fps_counter = 0;
+        fps_steps = sim_steps;
         fps_timer = current_time;
         
         char title[256];
@@ -497,24 +3289,153 @@ void display_fps() {
                 star_system->count, fps, omp_get_max_threads());
         glutSetWindowTitle(title);
         
-        printf("FPS: %.1f | Threads activos: %d\n", fps, omp_get_max_threads());
+        printf("FPS: %.1f | Pasos/seg: %.1f | Threads activos: %d\n", fps, steps_per_second, omp_get_max_threads());
         if (fps < 30) printf("ADVERTENCIA: FPS por debajo de 30!\n");
     }
 }
 
+// Guarda las posiciones actuales antes de avanzar un paso
+void save_previous_positions() {
+    int n = star_system->count;
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        star_system->prev_x[i] = star_system->x[i];
+        star_system->prev_y[i] = star_system->y[i];
+    }
+}
+
+// Un paso fijo completo de la simulación
+void simulation_step() {
+    double start = omp_get_wtime();
+    save_previous_positions();
+    update_spatial_grid();
+    reorder_if_due(sim_steps);
+    apply_physics_optimized();
+    apply_star_interactions();
+    sim_steps++;
+    record_frame(star_system->count);
+    trace_event("paso", "frame", start, omp_get_wtime());
+}
+
+// Avanza la simulación hasta 'now' en pasos de SIM_DT. Si el render se
+// atrasa corre varios pasos por frame, hasta MAX_SUBSTEPS; el atraso que
+// quede se descarta para no entrar en una espiral de pasos cada vez más lenta.
+int advance_simulation(double now) {
+    if (sim_last_time < 0.0) sim_last_time = now - SIM_DT;
+    sim_accumulator += now - sim_last_time;
+    sim_last_time = now;
+    
+    int steps = 0;
+    while (sim_accumulator >= SIM_DT && steps < MAX_SUBSTEPS) {
+        simulation_step();
+        sim_accumulator -= SIM_DT;
+        steps++;
+    }
+    if (sim_accumulator >= SIM_DT) {
+        sim_accumulator = fmod(sim_accumulator, SIM_DT);
+    }
+    
+    render_alpha = (float)(sim_accumulator / SIM_DT);
+    return steps;
+}
+
+// Publica el estado de star_system en el buffer frontal. Por paso solo
+// cambian posiciones y fase del pulso; el resto de columnas se copia
+// únicamente tras un reorden o al agregar estrellas.
+int publish_front_buffer() {
+    StarSystem* src = star_system;
+    StarSystem* dst = front_system;
+    int n = src->count;
+    
+    if (!reserve_star_system(dst, src->capacity)) return 0;
+    int copy_static = front_static_dirty;
+    
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        dst->x[i] = src->x[i];
+        dst->y[i] = src->y[i];
+        dst->prev_x[i] = src->prev_x[i];
+        dst->prev_y[i] = src->prev_y[i];
+        dst->pulse_phase[i] = src->pulse_phase[i];
+        if (copy_static) {
+            dst->brightness[i] = src->brightness[i];
+            dst->size[i] = src->size[i];
+            dst->r[i] = src->r[i];
+            dst->g[i] = src->g[i];
+            dst->b[i] = src->b[i];
+            dst->glow_intensity[i] = src->glow_intensity[i];
+            dst->star_type[i] = src->star_type[i];
+        }
+    }
+    
+    dst->count = n;
+    front_alpha = render_alpha;
+    front_static_dirty = 0;
+    return 1;
+}
+
+// Reparto del presupuesto de threads entre las dos ramas del pipeline. Sin
+// esto cada equipo anidado hereda omp_get_max_threads() y se lanzan 2N threads
+// sobre N núcleos. La simulación domina el frame, así que el render se queda
+// con una cuarta parte (mínimo 1) y la simulación con el resto. Devuelve el
+// tamaño del equipo exterior: con un solo thread render y simulación van en serie.
+int split_pipeline_threads(int* render_threads, int* sim_threads) {
+    int budget = omp_get_max_threads();
+    if (budget < 2) {
+        *render_threads = 1;
+        *sim_threads = 1;
+        return 1;
+    }
+    *render_threads = budget / 4 > 0 ? budget / 4 : 1;
+    *sim_threads = budget - *render_threads;
+    return 2;
+}
+
+// Frame en pipeline: el thread 0 del equipo (el de GL, dueño del contexto)
+// dibuja desde el buffer frontal mientras el thread 1 avanza la simulación;
+// cada uno abre sus propios equipos anidados con su parte de los threads.
+// Al terminar ambos se publica.
+int pipelined_frame(double now) {
+    int steps = 0;
+    int render_threads, sim_threads;
+    int team = split_pipeline_threads(&render_threads, &sim_threads);
+    
+    #pragma omp parallel num_threads(team)
+    {
+        int tid = omp_get_thread_num();
+        if (tid == 0) {
+            omp_set_num_threads(render_threads);
+            double start = omp_get_wtime();
+            render_stars(front_system, front_alpha);
+            trace_event("render", "frame", start, omp_get_wtime());
+        }
+        if (tid == 1 || omp_get_num_threads() == 1) {
+            omp_set_num_threads(sim_threads);
+            double start = omp_get_wtime();
+            steps = advance_simulation(now);
+            trace_event("simulacion", "frame", start, omp_get_wtime());
+        }
+    }
+    
+    double start = omp_get_wtime();
+    publish_front_buffer();
+    trace_event("publicacion", "frame", start, omp_get_wtime());
+    return steps;
+}
+
 void display() {
     glClearColor(0.02f, 0.01f, 0.05f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     double start_time = omp_get_wtime();
-    update_spatial_grid();
-    
-    apply_physics_optimized();
-    
-    apply_star_interactions();
+    int steps;
     
-    frame_time = omp_get_wtime() - start_time;
-    for (int i = 0; i < star_system->count; i++) {
-        render_star(i);
+    if (pipeline_enabled) {
+        steps = pipelined_frame(start_time);
+        frame_time = omp_get_wtime() - start_time;
+    } else {
+        steps = advance_simulation(start_time);
+        frame_time = omp_get_wtime() - start_time;
+        render_stars(star_system, render_alpha);
     }
     
     current_frame++;
@@ -522,13 +3443,17 @@ void display() {
     // Mostrar estadísticas cada 200 frames
     if (current_frame % 200 == 0) {
         printf("\n=== ESTADÍSTICAS DE RENDIMIENTO ===\n");
-        printf("Frame %d: %.6f segundos de cálculo\n", current_frame, frame_time);
+        printf("Frame %d: %.6f segundos de cálculo (%d pasos de física, %lld en total)\n",
+               current_frame, frame_time, steps, sim_steps);
         printf("Estrellas: %d | Threads activos: %d\n", star_system->count, omp_get_max_threads());
         printf("Tiempo promedio por estrella: %.8f segundos\n", frame_time / star_system->count);
     }
     
     display_fps();
+    double swap_start = omp_get_wtime();
     glutSwapBuffers();
+    profile_end(PHASE_SWAP, swap_start);
+    trace_event("frame", "frame", start_time, omp_get_wtime());
 }
 
 void reshape(int width, int height) {
@@ -543,40 +3468,30 @@ void reshape(int width, int height) {
 void keyboard(unsigned char key, int x, int y) {
     switch(key) {
         case 27: case 'q': case 'Q':
+            if (profile_prefix) profile_dump(profile_prefix);
+            if (snapshot_save_path) save_snapshot(snapshot_save_path);
+            record_end();
+            trace_flush();
             destroy_star_system(star_system);
+            destroy_star_system(reorder_scratch);
+            destroy_star_system(front_system);
             destroy_spatial_grid(spatial_grid);
+            free_render_batch(&render_batch);
+            free_soft_raster(&soft_raster);
             glutDestroyWindow(window_id);
             exit(0);
             break;
             
         case '+':
-            if (star_system->count < MAX_STARS - 50) {
+            if (star_system->count <= MAX_STARS - 50 &&
+                reserve_star_system(star_system, star_system->count + 50)) {
                 int old_count = star_system->count;
                 star_system->count += 50;
-
-                if (star_system->count > star_system->capacity) {
-                    StarSystem* new_system = create_star_system(star_system->count);
-                    memcpy(new_system->x, star_system->x, old_count * sizeof(float));
-                    memcpy(new_system->y, star_system->y, old_count * sizeof(float));
-                    memcpy(new_system->vx, star_system->vx, old_count * sizeof(float));
-                    memcpy(new_system->vy, star_system->vy, old_count * sizeof(float));
-                    memcpy(new_system->brightness, star_system->brightness, old_count * sizeof(float));
-                    memcpy(new_system->pulse_phase, star_system->pulse_phase, old_count * sizeof(float));
-                    memcpy(new_system->pulse_speed, star_system->pulse_speed, old_count * sizeof(float));
-                    memcpy(new_system->size, star_system->size, old_count * sizeof(float));
-                    memcpy(new_system->r, star_system->r, old_count * sizeof(float));
-                    memcpy(new_system->g, star_system->g, old_count * sizeof(float));
-                    memcpy(new_system->b, star_system->b, old_count * sizeof(float));
-                    memcpy(new_system->glow_intensity, star_system->glow_intensity, old_count * sizeof(float));
-                    memcpy(new_system->star_type, star_system->star_type, old_count * sizeof(int));
-                    
-                    destroy_star_system(star_system);
-                    star_system = new_system;
-                }
                 #pragma omp parallel for schedule(static)
                 for (int i = old_count; i < star_system->count; i++) {
                     init_star(i);
                 }
+                front_static_dirty = 1;
             }
             break;
             
@@ -586,11 +3501,19 @@ void keyboard(unsigned char key, int x, int y) {
             }
             break;
             
+        case 'p': case 'P':
+            profile_dump(profile_prefix ? profile_prefix : "perfil");
+            break;
+            
+        case 's': case 'S':
+            save_snapshot(snapshot_save_path ? snapshot_save_path : "snapshot.stars");
+            break;
+            
         case 't': case 'T':
-            // Toggle número de threads
+            // Alternar entre 1 thread y los configurados (--threads / OMP_NUM_THREADS)
             {
                 int current_threads = omp_get_max_threads();
-                int new_threads = (current_threads == 1) ? omp_get_num_procs() : 1;
+                int new_threads = (current_threads == 1) ? configured_threads : 1;
                 omp_set_num_threads(new_threads);
                 printf("Threads cambiados a: %d\n", new_threads);
             }
@@ -599,9 +3522,17 @@ void keyboard(unsigned char key, int x, int y) {
         case 'b': case 'B':
             printf("\n=== OPTIMIZACIONES IMPLEMENTADAS ===\n");
             printf("Memory alignment (%d bytes) para cache efficiency\n", CACHE_LINE_SIZE);
+            printf("Arena única de %d columnas: %.1f MB (capacidad %d estrellas)%s\n",
+                   STAR_COLUMNS, star_system->arena_bytes / (1024.0 * 1024.0), star_system->capacity,
+                   use_hugepages ? " con páginas grandes" : "");
             printf("Grid espacial (%dx%d) para optimizar interacciones O(N²)→O(N)\n", 
                    GRID_SIZE, GRID_SIZE);
-            printf("Threads disponibles: %d\n", omp_get_max_threads());
+            report_affinity();
+            printf("Primer toque NUMA de las columnas con el reparto estático de los threads\n");
+            printf("Kernel de física: %s (despacho por CPUID)\n", physics_kernel_name);
+            printf("Pipeline física/render con doble buffer: %s\n", pipeline_enabled ? "activo" : "desactivado");
+            printf("Render: %s\n", instanced_render ? "instanciado en GPU (columnas del SoA)" :
+                   software_render ? "rasterizador por software" : "lote de vértices en CPU");
             printf("Tiempo actual por frame: %.6f segundos\n", frame_time);
             break;
     }
@@ -620,17 +3551,241 @@ void init_opengl() {
     glEnable(GL_ALPHA_TEST);
     glAlphaFunc(GL_GREATER, 0.0f);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    
+    // Atlas de brillo: solo alpha, el color sale del vértice (GL_MODULATE)
+    glGenTextures(1, &glow_texture);
+    glBindTexture(GL_TEXTURE_2D, glow_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, GLOW_ATLAS_WIDTH, GLOW_ATLAS_CELL, 0,
+                 GL_ALPHA, GL_UNSIGNED_BYTE, glow_atlas);
+}
+
+// Pasos fijos de un frame headless, acumulando el tiempo de cada fase
+void headless_steps(double* grid_time, double* physics_time, double* interactions_time) {
+    for (int step = 0; step < headless_substeps; step++) {
+        double t0 = omp_get_wtime();
+        save_previous_positions();
+        update_spatial_grid();
+        reorder_if_due(sim_steps);
+        double t1 = omp_get_wtime();
+        apply_physics_optimized();
+        double t2 = omp_get_wtime();
+        apply_star_interactions();
+        double t3 = omp_get_wtime();
+        sim_steps++;
+        record_frame(star_system->count);
+        trace_event("paso", "frame", t0, t3);
+        
+        *grid_time += t1 - t0;
+        *physics_time += t2 - t1;
+        *interactions_time += t3 - t2;
+    }
+}
+
+// Benchmark sin ventana: el mismo pipeline de display() sin glutMainLoop
+// ni el timer de 16 ms. Sin contexto GL render_stars no envía el lote, así
+// que la fase de render mide solo la generación de vértices (o el raster por software).
+// Cada frame ejecuta headless_substeps pasos fijos (render lento que se pone al día).
+// Con pipeline, render y simulación se solapan y el total es menor que la suma.
+void run_headless() {
+    double grid_time = 0.0, physics_time = 0.0, interactions_time = 0.0, render_time = 0.0;
+    double publish_time = 0.0;
+    if (headless_frames == 0) return;  // Solo inicializar (p. ej. para --save)
+    
+    printf("Benchmark headless: %d frames con %d estrellas...\n", headless_frames, star_system->count);
+    double start_time = omp_get_wtime();
+    
+    for (int frame = 0; frame < headless_frames; frame++) {
+        if (pipeline_enabled) {
+            int render_threads, sim_threads;
+            int team = split_pipeline_threads(&render_threads, &sim_threads);
+            #pragma omp parallel num_threads(team)
+            {
+                int tid = omp_get_thread_num();
+                if (tid == 0) {
+                    omp_set_num_threads(render_threads);
+                    double t0 = omp_get_wtime();
+                    render_stars(front_system, front_alpha);
+                    render_time += omp_get_wtime() - t0;
+                }
+                if (tid == 1 || omp_get_num_threads() == 1) {
+                    omp_set_num_threads(sim_threads);
+                    headless_steps(&grid_time, &physics_time, &interactions_time);
+                }
+            }
+            double t0 = omp_get_wtime();
+            publish_front_buffer();
+            double t1 = omp_get_wtime();
+            trace_event("publicacion", "frame", t0, t1);
+            publish_time += t1 - t0;
+        } else {
+            headless_steps(&grid_time, &physics_time, &interactions_time);
+            double t0 = omp_get_wtime();
+            render_stars(star_system, render_alpha);
+            render_time += omp_get_wtime() - t0;
+        }
+    }
+    
+    double total_time = omp_get_wtime() - start_time;
+    
+    printf("\n=== BENCHMARK HEADLESS ===\n");
+    char physics_sched[32], interactions_sched[32];
+    printf("Frames: %d | Estrellas: %d | Threads: %d | Kernel: %s | Pipeline: %s\n",
+           headless_frames, star_system->count, omp_get_max_threads(), physics_kernel_name,
+           pipeline_enabled ? "sí" : "no");
+    report_affinity();
+    printf("Schedules: física %s | interacciones %s\n",
+           schedule_label(&physics_schedule, physics_sched, sizeof(physics_sched)),
+           schedule_label(&interactions_schedule, interactions_sched, sizeof(interactions_sched)));
+    printf("Grid espacial: %.6f s total | %.4f ms/frame\n", grid_time, grid_time * 1000.0 / headless_frames);
+    printf("Física:        %.6f s total | %.4f ms/frame\n", physics_time, physics_time * 1000.0 / headless_frames);
+    printf("Interacciones: %.6f s total | %.4f ms/frame\n", interactions_time, interactions_time * 1000.0 / headless_frames);
+    printf("Render:        %.6f s total | %.4f ms/frame\n", render_time, render_time * 1000.0 / headless_frames);
+    if (pipeline_enabled) {
+        printf("Publicación:   %.6f s total | %.4f ms/frame\n", publish_time, publish_time * 1000.0 / headless_frames);
+    }
+    printf("Total:         %.6f s | %.1f frames/seg\n", total_time, headless_frames / total_time);
+    printf("Pasos:         %lld (dt = %.4f s) | %.1f pasos/seg | %.1f s simulados\n",
+           sim_steps, SIM_DT, sim_steps / total_time, sim_steps * SIM_DT);
 }
 
 int validate_input(int argc, char* argv[]) {
-    if (argc != 2) {
-        printf("Uso: %s <numero_de_estrellas>\n", argv[0]);
+    if (argc < 2) {
+        printf("Uso: %s <numero_de_estrellas> [--headless] [--frames N] [--seed S] [--substeps N] [--reorder N] [--load F] [--save F] [--record F] [--compare G] [--no-interactions] [--software-render] [--soft-output P] [--instanced] [--threads N] [--bind B] [--places P] [--no-pipeline] [--profile PREFIJO] [--trace ARCHIVO.json] [--sched-physics S] [--sched-interactions S]\n", argv[0]);
         printf("Controles:\n");
         printf("  ESC/Q: Salir\n");
         printf("  +: Agregar 50 estrellas\n");
         printf("  -: Quitar 50 estrellas\n");
         printf("  T: Toggle número de threads\n");
         printf("  B: Mostrar optimizaciones implementadas\n");
+        printf("  P: Volcar el perfil por fase (CSV/JSON)\n");
+        printf("  S: Guardar un snapshot del estado actual\n");
+        printf("Benchmark sin ventana: %s 2000 --headless --frames 1000\n", argv[0]);
+        printf("--substeps N: pasos de física por frame en headless (la física corre a %d pasos/seg fijos)\n", FPS_TARGET);
+        printf("--reorder N: reordenar estrellas por celda del grid cada N pasos de física\n");
+        printf("--selftest-simd: comparar los kernels SIMD contra el escalar y salir\n");
+        printf("--hugepages: respaldar la arena de estrellas con páginas grandes (Linux)\n");
+        printf("--no-pipeline: física y render en secuencia en lugar de solapados\n");
+        printf("--load ARCHIVO: partir de un snapshot (mapeado con mmap; usa su número de estrellas)\n");
+        printf("--save ARCHIVO: guardar un snapshot al salir (--headless --frames 0 solo inicializa)\n");
+        printf("--record ARCHIVO: grabar las posiciones de cada paso de física (thread escritor aparte)\n");
+        printf("  --record-encoding raw|q16|delta (por defecto delta), --record-colors: también color y brillo\n");
+        printf("--compare GOLDEN [--tolerance T]: al terminar el headless, deriva de x, y, vx, vy contra un\n");
+        printf("  snapshot (código de salida 2 si supera T, 1e-3 por defecto). Ver regression.sh\n");
+        printf("--no-interactions: solo la física común a los tres builds (regresión cruzada)\n");
+        printf("--software-render: rasterizar en CPU por tiles (OpenMP) en lugar de OpenGL\n");
+        printf("  --soft-output PREFIJO: guardar cada frame como PREFIJO_NNNNNN.ppm (--soft-format raw: .rgba)\n");
+        printf("--instanced: dibujar con instancing en GPU directo desde las columnas del SoA (GL 3.3)\n");
+        printf("--threads N: threads de OpenMP (por defecto OMP_NUM_THREADS o todos los cores)\n");
+        printf("--bind close|spread|master|true|false, --places cores|threads|sockets|...:\n");
+        printf("  afinidad de los threads, igual que OMP_PROC_BIND / OMP_PLACES\n");
+        printf("--profile PREFIJO: al salir, guardar el perfil por fase en PREFIJO.csv y PREFIJO.json\n");
+        printf("--trace ARCHIVO.json: grabar la línea de tiempo por thread (chrome://tracing / Perfetto)\n");
+        printf("--sched-physics / --sched-interactions TIPO[,CHUNK]: scheduling de cada kernel\n");
+        printf("  (static|dynamic|guided|auto; por defecto guided y dynamic)\n");
+        return -1;
+    }
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headless_mode = 1;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            headless_frames = atoi(argv[++i]);
+            if (headless_frames < 0) {
+                printf("Error: --frames debe ser un entero no negativo\n");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            star_seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--substeps") == 0 && i + 1 < argc) {
+            headless_substeps = atoi(argv[++i]);
+            if (headless_substeps <= 0) {
+                printf("Error: --substeps debe ser un entero positivo\n");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--reorder") == 0 && i + 1 < argc) {
+            reorder_interval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--selftest-simd") == 0) {
+            simd_selftest = 1;
+        } else if (strcmp(argv[i], "--hugepages") == 0) {
+            use_hugepages = 1;
+        } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            compare_path = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            compare_tolerance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--software-render") == 0) {
+            software_render = 1;
+        } else if (strcmp(argv[i], "--soft-output") == 0 && i + 1 < argc) {
+            software_render = 1;
+            soft_output_prefix = argv[++i];
+        } else if (strcmp(argv[i], "--soft-format") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "raw") == 0) soft_output_raw = 1;
+            else if (strcmp(argv[i], "ppm") == 0) soft_output_raw = 0;
+            else {
+                printf("Error: Formato inválido: %s (ppm|raw)\n", argv[i]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--instanced") == 0) {
+            instanced_render = 1;
+        } else if (strcmp(argv[i], "--no-interactions") == 0) {
+            interactions_enabled = 0;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--record-colors") == 0) {
+            record_colors = 1;
+        } else if (strcmp(argv[i], "--record-encoding") == 0 && i + 1 < argc) {
+            if (!parse_record_encoding(argv[++i])) {
+                printf("Error: Codificación inválida: %s (raw|q16|delta)\n", argv[i]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            snapshot_load_path = argv[++i];
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            snapshot_save_path = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            requested_threads = atoi(argv[++i]);
+            if (requested_threads <= 0) {
+                printf("Error: --threads debe ser un entero positivo\n");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) {
+            requested_bind = argv[++i];
+        } else if (strcmp(argv[i], "--places") == 0 && i + 1 < argc) {
+            requested_places = argv[++i];
+        } else if (strcmp(argv[i], "--no-pipeline") == 0) {
+            pipeline_enabled = 0;
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile_prefix = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_begin(argv[++i]);
+        } else if (strcmp(argv[i], "--sched-physics") == 0 && i + 1 < argc) {
+            if (!parse_schedule(argv[++i], &physics_schedule)) {
+                printf("Error: Schedule inválido: %s (static|dynamic|guided|auto[,chunk])\n", argv[i]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--sched-interactions") == 0 && i + 1 < argc) {
+            if (!parse_schedule(argv[++i], &interactions_schedule)) {
+                printf("Error: Schedule inválido: %s (static|dynamic|guided|auto[,chunk])\n", argv[i]);
+                return -1;
+            }
+        } else {
+            printf("Error: Opción desconocida: %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (instanced_render && (headless_mode || software_render)) {
+        // Sin ventana no hay contexto GL donde subir las columnas
+        printf("Error: --instanced necesita ventana y no es compatible con --headless ni --software-render\n");
+        return -1;
+    }
+    if (record_path && reorder_interval > 0) {
+        // El reorden permuta los índices: las trayectorias dejarían de ser por estrella
+        printf("Error: --record no es compatible con --reorder\n");
         return -1;
     }
     int n = atoi(argv[1]);
@@ -642,30 +3797,52 @@ int validate_input(int argc, char* argv[]) {
 }
 
 int main(int argc, char* argv[]) {
+    star_seed = (uint64_t)time(NULL);
     int num_stars = validate_input(argc, argv);
     if (num_stars == -1) return 1;
-    omp_set_dynamic(0);  
-    omp_set_nested(1);   
+    if (apply_affinity_environment(argv) < 0) return 1;
+    init_trig_tables();
+    init_glow_atlas();
+    omp_set_dynamic(0);
+    if (requested_threads > 0) omp_set_num_threads(requested_threads);
+    configured_threads = omp_get_max_threads();
+    // Solo el pipeline anida regiones (render y simulación abren sus equipos)
+    omp_set_max_active_levels(pipeline_enabled ? 2 : 1);
+    select_physics_kernel();
+    
+    if (simd_selftest) {
+        return run_simd_selftest(num_stars);
+    }
     
     printf("Inicializando screensaver optimizado con %d estrellas...\n", num_stars);
-    printf("Threads disponibles: %d\n", omp_get_max_threads());
+    report_affinity();
+    printf("Kernel de física: %s\n", physics_kernel_name);
     printf("Presiona 'B' para ver optimizaciones implementadas\n");
     
-    glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_ALPHA);
-    glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
-    glutInitWindowPosition(100, 100);
-    
-    char title[256];
-    snprintf(title, sizeof(title), "Screensaver Optimizado - Estrellas: %d | Threads: %d", 
-             num_stars, omp_get_max_threads());
-    window_id = glutCreateWindow(title);
+    if (!headless_mode) {
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_ALPHA);
+        glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
+        glutInitWindowPosition(100, 100);
+        
+        char title[256];
+        snprintf(title, sizeof(title), "Screensaver Optimizado - Estrellas: %d | Threads: %d", 
+                 num_stars, omp_get_max_threads());
+        window_id = glutCreateWindow(title);
+    }
     
-    srand((unsigned int)time(NULL));
-    star_system = create_star_system(num_stars);
-    if (!star_system) {
-        printf("Error: No se pudo allocar memoria para el sistema de estrellas\n");
-        return 1;
+    if (snapshot_load_path) {
+        star_system = load_snapshot(snapshot_load_path);
+        if (!star_system) return 1;
+        num_stars = star_system->count;
+        printf("Snapshot %s mapeado: %d estrellas, paso %lld\n", snapshot_load_path, num_stars, sim_steps);
+    } else {
+        star_system = create_star_system(num_stars);
+        if (!star_system) {
+            printf("Error: No se pudo allocar memoria para el sistema de estrellas\n");
+            return 1;
+        }
+        first_touch_star_system(star_system);
     }
     
     // Crear grid espacial
@@ -676,27 +3853,71 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    printf("Inicializando %d estrellas en paralelo...\n", num_stars);
-    double start_time = omp_get_wtime();
+    if (!snapshot_load_path) {
+        printf("Inicializando %d estrellas en paralelo (semilla %llu)...\n",
+               num_stars, (unsigned long long)star_seed);
+        double start_time = omp_get_wtime();
+        
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_stars; i++) {
+            init_star(i);
+        }
+        
+        double init_time = omp_get_wtime() - start_time;
+        printf("Inicialización completada en %.4f segundos\n", init_time);
+    }
+    
+    // Buffer frontal para el pipeline, con el estado inicial ya publicado
+    if (pipeline_enabled) {
+        front_system = create_star_system(num_stars);
+        if (front_system) first_touch_star_system(front_system);
+        if (!front_system || !publish_front_buffer()) {
+            printf("Error: No se pudo allocar el buffer frontal del pipeline\n");
+            destroy_star_system(star_system);
+            destroy_spatial_grid(spatial_grid);
+            return 1;
+        }
+    }
     
-    #pragma omp parallel for schedule(static) num_threads(omp_get_max_threads())
-    for (int i = 0; i < num_stars; i++) {
-        init_star(i);
+    // Trayectorias: el estado inicial es el primer frame grabado
+    if (record_path) {
+        if (!record_begin(record_path)) return 1;
+        record_frame(star_system->count);
     }
     
-    double init_time = omp_get_wtime() - start_time;
-    printf("Inicialización completada en %.4f segundos\n", init_time);
+    if (headless_mode) {
+        run_headless();
+        if (profile_prefix) profile_dump(profile_prefix);
+        if (snapshot_save_path) save_snapshot(snapshot_save_path);
+        record_end();
+        trace_flush();
+        int regression_ok = compare_path ? compare_snapshot(compare_path) : 1;
+        destroy_star_system(star_system);
+        destroy_star_system(reorder_scratch);
+        destroy_star_system(front_system);
+        destroy_spatial_grid(spatial_grid);
+        free_render_batch(&render_batch);
+        free_soft_raster(&soft_raster);
+        return regression_ok ? 0 : 2;
+    }
     
     init_opengl();
+    if (instanced_render && !init_instanced_renderer()) instanced_render = 0;
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     glutKeyboardFunc(keyboard);
     glutTimerFunc(0, timer, 0);
-    fps_timer = clock();
+    fps_timer = omp_get_wtime();
     
     glutMainLoop();
 
+    record_end();
+    trace_flush();
     destroy_star_system(star_system);
+    destroy_star_system(reorder_scratch);
+    destroy_star_system(front_system);
     destroy_spatial_grid(spatial_grid);
+    free_render_batch(&render_batch);
+    free_soft_raster(&soft_raster);
     return 0;
 }
\ No newline at end of file